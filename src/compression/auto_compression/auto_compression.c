@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <zlib.h>
+#include "../../wrapper_functions.h"
+#include "../compression.h"
+#include "../../utils.h"
+
+#define SAMPLE_SIZE 64 * 1024
+
+#define MAX_STORED_SUFFIXES 	64
+
+#define STORE_ENTROPY 		7.9 	// bits per byte, at least this much looks like compressed or encrypted data
+#define COMPRESS_ENTROPY 	6.0 	// bits per byte, at most this much always compresses well
+#define TRIAL_LEVEL 		1
+#define MIN_TRIAL_SAVINGS 	0.05 	// fraction of the sample the trial compression must save
+
+
+// Formats that are already compressed, replaced by auto_compression_set_stored_suffixes
+static TCHAR default_stored_suffixes[] = TEXT(".zip:.jar:.war:.apk:.docx:.xlsx:.pptx:.odt:.gz:.tgz:.bz2:.xz:.lz:.lz4:.zst:.7z:.rar:.cab")
+	TEXT(":.jpg:.jpeg:.png:.gif:.webp:.heic:.mp3:.aac:.ogg:.opus:.flac:.mp4:.m4a:.m4v:.mkv:.mov:.avi:.webm");
+
+static LPTSTR stored_suffixes[MAX_STORED_SUFFIXES];
+static unsigned num_stored_suffixes;
+static bool stored_suffixes_set;
+static INIT_ONCE default_stored_suffixes_set = INIT_ONCE_STATIC_INIT;
+
+/* Helper Functions */
+
+static bool has_stored_suffix(LPTSTR file_name) {
+	size_t name_length = _tcslen(file_name);
+
+	for(unsigned i = 0; i < num_stored_suffixes; i++) {
+		size_t suffix_length = _tcslen(stored_suffixes[i]);
+		if(suffix_length <= name_length && _tcsicmp(file_name + name_length - suffix_length, stored_suffixes[i]) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Returns the Shannon entropy of the specified data, in bits per byte.
+*/
+static double byte_entropy(const unsigned char* data, size_t length) {
+	size_t counts[256] = {0};
+	for(size_t i = 0; i < length; i++)
+		counts[data[i]]++;
+
+	double entropy = 0;
+	for(unsigned i = 0; i < 256; i++)
+		if(counts[i] > 0) {
+			double p = (double) counts[i] / length;
+			entropy -= p * log2(p);
+		}
+
+	return entropy;
+}
+
+/**
+ * Returns whether a quick, low level Deflate of the specified data saves enough space to be
+ * worth compressing the whole file.
+*/
+static bool trial_compression_pays_off(const unsigned char* data, size_t length) {
+	uLongf compressed_length = compressBound(length);
+	unsigned char* compressed = Malloc(compressed_length);
+
+	bool pays_off = compress2(compressed, &compressed_length, data, length, TRIAL_LEVEL) == Z_OK
+		&& compressed_length <= length * (1 - MIN_TRIAL_SAVINGS);
+
+	Free(compressed);
+	return pays_off;
+}
+
+/**
+ * Sets the default stored suffixes unless others were set. Files are selected for concurrently, so it only runs once.
+*/
+static BOOL WINAPI set_default_stored_suffixes(PINIT_ONCE init_once, LPVOID parameter, LPVOID* context) {
+	if(!stored_suffixes_set)
+		auto_compression_set_stored_suffixes(default_stored_suffixes);
+	return TRUE;
+}
+
+/**
+ * Chooses between storing and compressing a file by the specified sample of the head of its content.
+*/
+static uint16_t select_by_sample(const unsigned char* sample, size_t sample_size, uint16_t compression_method) {
+	// The entropy settles the obvious cases, only the ones in between are trial compressed
+	double entropy = byte_entropy(sample, sample_size);
+	bool compress = entropy <= COMPRESS_ENTROPY || (entropy < STORE_ENTROPY && trial_compression_pays_off(sample, sample_size));
+
+	return compress ? compression_method : NO_COMPRESSION;
+}
+
+static bool is_always_stored(LPTSTR file_name, uint16_t compression_method) {
+	_InitOnceExecuteOnce(&default_stored_suffixes_set, set_default_stored_suffixes, NULL, NULL);
+	return compression_method == NO_COMPRESSION || has_stored_suffix(file_name);
+}
+
+
+/* Header Implementations */
+
+void auto_compression_set_stored_suffixes(LPTSTR suffixes) {
+	num_stored_suffixes = 0;
+	stored_suffixes_set = true;
+
+	// Split the list in place, empty suffixes are skipped
+	LPTSTR suffix = suffixes;
+	while(num_stored_suffixes < MAX_STORED_SUFFIXES) {
+		LPTSTR end = suffix;
+		while(*end != TEXT('\0') && *end != TEXT(':') && *end != TEXT(';'))
+			end++;
+
+		bool is_last = *end == TEXT('\0');
+		*end = TEXT('\0');
+
+		if(end != suffix)
+			stored_suffixes[num_stored_suffixes++] = suffix;
+
+		if(is_last)
+			break;
+		suffix = end + 1;
+	}
+}
+
+uint16_t auto_compression_select(LPTSTR file_name, uint64_t file_size, uint16_t compression_method) {
+	if(is_always_stored(file_name, compression_method))
+		return NO_COMPRESSION;
+
+	// Sample the head of the file
+	DWORD sample_size = MIN(SAMPLE_SIZE, file_size);
+	unsigned char* sample = Malloc(sample_size);
+
+	HANDLE hFile = _CreateFile(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	DWORD bytes_read = _ReadFileAt(hFile, sample, sample_size, 0);
+	_CloseHandle(hFile);
+
+	if(bytes_read != sample_size)
+		exit_with_error("File changed while being read\n");
+
+	uint16_t selected_compression_method = select_by_sample(sample, sample_size, compression_method);
+	Free(sample);
+	return selected_compression_method;
+}
+
+uint16_t auto_compression_select_buffer(LPTSTR file_name, const void* data, size_t size, uint16_t compression_method) {
+	if(is_always_stored(file_name, compression_method))
+		return NO_COMPRESSION;
+
+	return select_by_sample(data, MIN(SAMPLE_SIZE, size), compression_method);
+}
@@ -1,40 +1,179 @@
 #ifndef _COMPRESSION_H
 #define _COMPRESSION_H
 
-#include <windows.h>
+#include "../platform.h"
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
 
-#define NO_COMPRESSION 0
+#define NO_COMPRESSION 	0
+#define DEFLATE 		8
+#define ZSTANDARD 		93
+
+#define AUTO_COMPRESSION 	0x8000 	// ORed into a compression method to store the files it wouldn't shrink
+
+#define DEFLATE_MIN_LEVEL 		1
+#define DEFLATE_MAX_LEVEL 		9
+#define DEFLATE_DEFAULT_LEVEL 	6
+
+#define ZSTANDARD_MIN_LEVEL 		1
+#define ZSTANDARD_MAX_LEVEL 		22
+#define ZSTANDARD_DEFAULT_LEVEL 	3
 
 typedef struct {
 	uint64_t destination_size;
 	uint32_t crc32;
 } compression_result;
 
-typedef compression_result decompression_result;
+typedef struct {
+	uint64_t destination_size;
+	uint32_t crc32;
+	bool valid; 	// false if the compressed data is corrupt, in which case the other fields are meaningless
+} decompression_result;
 
 /**
  * Copies data from the specified origin file to the specified destination file and
  * returns the compression result.
  * 
  * @param origin_name the name of the origin file
- * @param dest_name the name of the destination file
+ * @param hDest the destination file, written sequentially from the offset if it isn't a disk file
  * @param dest_offset the offset in the destination file to start writing data to
  * @param file_size the number of bytes to copy
  * @return the compression result
 */
-compression_result no_compression_compress(LPWSTR origin_name, LPWSTR dest_name, uint64_t dest_offset, uint64_t file_size);
+compression_result no_compression_compress(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size);
 
 /**
  * Copies data from the specified origin file to the specified destination file
- * and returns the file's crc32.
+ * and returns the decompression result.
  * 
  * @param origin_name the name of the origin file
- * @param dest_name the name of the destination file
+ * @param dest_name the name of the destination file, or NULL to only check the data
  * @param origin_offset the offset in the origin file to start reading data from
  * @param file_size the number of bytes to copy
- * @return the file's crc32
+ * @return the decompression result
+*/
+decompression_result no_compression_decompress(LPTSTR origin_name, LPTSTR dest_name, uint64_t origin_offset, uint64_t file_size);
+
+/**
+ * Sets the compression level used by deflate_compress.
+ * 
+ * @param level the compression level, from DEFLATE_MIN_LEVEL (fastest) to DEFLATE_MAX_LEVEL (smallest)
+*/
+void deflate_set_level(int level);
+
+/**
+ * Compresses data from the specified origin file into a raw Deflate stream written to the
+ * specified destination file and returns the compression result.
+ * 
+ * @param origin_name the name of the origin file
+ * @param hDest the destination file, written sequentially from the offset if it isn't a disk file
+ * @param dest_offset the offset in the destination file to start writing data to
+ * @param file_size the number of bytes to compress
+ * @return the compression result
 */
-uint32_t no_compression_decompress(LPWSTR origin_name, LPWSTR dest_name, uint64_t origin_offset, uint64_t file_size);
+compression_result deflate_compress(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size);
+
+/**
+ * Compresses the specified data into a newly allocated raw Deflate stream and returns the
+ * compression result.
+ * 
+ * @param data the data to compress
+ * @param size the number of bytes of data
+ * @param out_data where to store the compressed data, which the caller must free
+ * @return the compression result
+*/
+compression_result deflate_compress_buffer(const void* data, size_t size, unsigned char** out_data);
+
+/**
+ * Decompresses a raw Deflate stream from the specified origin file into the specified
+ * destination file and returns the decompression result.
+ * 
+ * @param origin_name the name of the origin file
+ * @param dest_name the name of the destination file, or NULL to only check the data
+ * @param origin_offset the offset in the origin file to start reading data from
+ * @param file_size the number of compressed bytes
+ * @return the decompression result
+*/
+decompression_result deflate_decompress(LPTSTR origin_name, LPTSTR dest_name, uint64_t origin_offset, uint64_t file_size);
+
+/**
+ * Sets the file name suffixes that auto_compression_select always stores, replacing the default
+ * list of already compressed formats. The list is split in place and must outlive its use. It must
+ * be called before any file is selected for.
+ * 
+ * @param suffixes the suffixes separated by ':' or ';', compared case-insensitively (e.g. ".jpg:.zip")
+*/
+void auto_compression_set_stored_suffixes(LPTSTR suffixes);
+
+/**
+ * Chooses between storing the specified file and compressing it with the specified compression
+ * method, by its name's suffix and by sampling the head of the file.
+ * 
+ * @param file_name the name of the file
+ * @param file_size the size of the file, greater than 0
+ * @param compression_method the compression method to use if the file looks compressible
+ * @return the compression method to use, either NO_COMPRESSION or the specified one
+*/
+uint16_t auto_compression_select(LPTSTR file_name, uint64_t file_size, uint16_t compression_method);
+
+/**
+ * Chooses between storing the specified file, whose content is already in memory, and compressing it
+ * with the specified compression method, just like auto_compression_select does.
+ * 
+ * @param file_name the name of the file
+ * @param data the content of the file
+ * @param size the size of the file, greater than 0
+ * @param compression_method the compression method to use if the file looks compressible
+ * @return the compression method to use, either NO_COMPRESSION or the specified one
+*/
+uint16_t auto_compression_select_buffer(LPTSTR file_name, const void* data, size_t size, uint16_t compression_method);
+
+// Zstandard is only available when the library is built against libzstd
+#ifdef ZSTANDARD_SUPPORTED
+
+/**
+ * Sets the compression level used by zstd_compress.
+ * 
+ * @param level the compression level, from ZSTANDARD_MIN_LEVEL (fastest) to ZSTANDARD_MAX_LEVEL (smallest)
+*/
+void zstd_set_level(int level);
+
+/**
+ * Compresses data from the specified origin file into a Zstandard frame written to the
+ * specified destination file and returns the compression result.
+ * 
+ * @param origin_name the name of the origin file
+ * @param hDest the destination file, written sequentially from the offset if it isn't a disk file
+ * @param dest_offset the offset in the destination file to start writing data to
+ * @param file_size the number of bytes to compress
+ * @return the compression result
+*/
+compression_result zstd_compress(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size);
+
+/**
+ * Compresses the specified data into a newly allocated Zstandard frame and returns the
+ * compression result.
+ * 
+ * @param data the data to compress
+ * @param size the number of bytes of data
+ * @param out_data where to store the compressed data, which the caller must free
+ * @return the compression result
+*/
+compression_result zstd_compress_buffer(const void* data, size_t size, unsigned char** out_data);
+
+/**
+ * Decompresses a Zstandard frame from the specified origin file into the specified
+ * destination file and returns the decompression result.
+ * 
+ * @param origin_name the name of the origin file
+ * @param dest_name the name of the destination file, or NULL to only check the data
+ * @param origin_offset the offset in the origin file to start reading data from
+ * @param file_size the number of compressed bytes
+ * @return the decompression result
+*/
+decompression_result zstd_decompress(LPTSTR origin_name, LPTSTR dest_name, uint64_t origin_offset, uint64_t file_size);
+
+#endif
 
 #endif
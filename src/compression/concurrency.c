@@ -1,4 +1,4 @@
-#include <windows.h>
+#include "../platform.h"
 #include "concurrency.h"
 
 static DWORD _num_cores;
@@ -11,4 +11,8 @@ DWORD num_cores() {
 	}
 	
 	return _num_cores;
-}
\ No newline at end of file
+}
+
+void set_num_cores(DWORD n) {
+	_num_cores = n;
+}
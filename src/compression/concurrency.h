@@ -1,6 +1,8 @@
 #ifndef _CONCURRENCY_H
 #define _CONCURRENCY_H
 
+#include "../platform.h"
+
 /**
  * Returns the number of cores in the system.
  * 
@@ -8,4 +10,12 @@
 */
 DWORD num_cores();
 
+/**
+ * Overrides the number of cores to use, which sizes the thread pool and how work is split.
+ * Must be called before any work is submitted.
+ * 
+ * @param n the number of cores to use
+*/
+void set_num_cores(DWORD n);
+
 #endif
\ No newline at end of file
@@ -1,80 +1,166 @@
-#include <windows.h>
+#include "../platform.h"
 #include "crc32.h"
+#include "crc32_simd.h"
+
+#define CRC32_SLICES 16
+#define CRC32_X2N_TABLE_SIZE 64
+
+/*
+ * crc32_table[0] is the classic byte-at-a-time table, crc32_table[k] holds the CRC32 of
+ * each byte followed by k zero bytes, which allows processing 16 bytes per iteration.
+ */
+static uint32_t crc32_table[CRC32_SLICES][256];
 
 /* 
- * The following section is taken from the zlib library.
- * CRC32 parts combination
+ * Updates a CRC32 register (not pre or post inverted) with the specified data.
+ * Points to the fastest implementation the processor supports.
+ */
+static uint32_t (*crc32_update_register)(uint32_t crc, const uint8_t* data, size_t length);
+
+
+/* Helper Functions */
+
+static uint32_t crc32_update_slicing(uint32_t crc, const uint8_t* data, size_t length) {
+	// Slicing-by-16
+	while(length >= CRC32_SLICES) {
+		crc ^= data[0] | data[1] << 8 | data[2] << 16 | (uint32_t) data[3] << 24;
+		crc = crc32_table[15][crc & 0xFF] ^ crc32_table[14][(crc >> 8) & 0xFF] ^ crc32_table[13][(crc >> 16) & 0xFF] ^ crc32_table[12][crc >> 24]
+			^ crc32_table[11][data[4]] ^ crc32_table[10][data[5]] ^ crc32_table[9][data[6]] ^ crc32_table[8][data[7]]
+			^ crc32_table[7][data[8]] ^ crc32_table[6][data[9]] ^ crc32_table[5][data[10]] ^ crc32_table[4][data[11]]
+			^ crc32_table[3][data[12]] ^ crc32_table[2][data[13]] ^ crc32_table[1][data[14]] ^ crc32_table[0][data[15]];
+
+		data += CRC32_SLICES;
+		length -= CRC32_SLICES;
+	}
+
+	// Remaining bytes
+	while(length--)
+		crc = (crc >> 8) ^ crc32_table[0][(crc ^ *data++) & 0xFF];
+
+	return crc;
+}
+
+#ifdef CRC32_SIMD_SUPPORTED
+
+// The folding kernels only handle multiples of 16 bytes, the rest goes through the tables
+
+static uint32_t crc32_update_pclmul(uint32_t crc, const uint8_t* data, size_t length) {
+	if(length >= CRC32_PCLMUL_MIN_LENGTH) {
+		size_t folded_length = length & ~(size_t) 15;
+		crc = crc32_pclmul(crc, data, folded_length);
+		data += folded_length;
+		length -= folded_length;
+	}
+
+	return crc32_update_slicing(crc, data, length);
+}
+
+static uint32_t crc32_update_vpclmul(uint32_t crc, const uint8_t* data, size_t length) {
+	if(length >= CRC32_VPCLMUL_MIN_LENGTH) {
+		size_t folded_length = length & ~(size_t) 15;
+		crc = crc32_vpclmul(crc, data, folded_length);
+		data += folded_length;
+		length -= folded_length;
+	}
+
+	return crc32_update_pclmul(crc, data, length);
+}
+
+#endif
+
+static void __attribute__((constructor)) crc32_init() {
+	for(unsigned i = 0; i < 256; i++) {
+		uint32_t crc = i;
+		for(unsigned char j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (CRC32_REVERSED_POLYNOMIAL & -(crc & 1));
+		crc32_table[0][i] = crc;
+	}
+
+	for(unsigned i = 0; i < 256; i++)
+		for(unsigned k = 1; k < CRC32_SLICES; k++)
+			crc32_table[k][i] = (crc32_table[k - 1][i] >> 8) ^ crc32_table[0][crc32_table[k - 1][i] & 0xFF];
+
+	// Select the fastest implementation
+	crc32_update_register = crc32_update_slicing;
+#ifdef CRC32_SIMD_SUPPORTED
+	if(crc32_vpclmul_supported())
+		crc32_update_register = crc32_update_vpclmul;
+	else if(crc32_pclmul_supported())
+		crc32_update_register = crc32_update_pclmul;
+#endif
+}
+
+
+/*
+ * x2n_table[k] is x^(2^k) mod P, the operator that shifts a CRC32 by 2^k zero bits.
+ * The sequence repeats every 32 entries, so indices past the table can wrap around.
  */
+static const uint32_t x2n_table[CRC32_X2N_TABLE_SIZE] = {
+	0x40000000, 0x20000000, 0x08000000, 0x00800000,
+	0x00008000, 0xedb88320, 0xb1e6b092, 0xa06a2517,
+	0xed627dae, 0x88d14467, 0xd7bbfe6a, 0xec447f11,
+	0x8e7ea170, 0x6427800e, 0x4d47bae0, 0x09fe548f,
+	0x83852d0f, 0x30362f1a, 0x7b5a9cc3, 0x31fec169,
+	0x9fec022a, 0x6c8dedc4, 0x15d6874d, 0x5fde7a4e,
+	0xbad90e37, 0x2e4e5eef, 0x4eaba214, 0xa8a472c0,
+	0x429a969e, 0x148d302a, 0xc40ba6d0, 0xc4e22c3c,
+	0x40000000, 0x20000000, 0x08000000, 0x00800000,
+	0x00008000, 0xedb88320, 0xb1e6b092, 0xa06a2517,
+	0xed627dae, 0x88d14467, 0xd7bbfe6a, 0xec447f11,
+	0x8e7ea170, 0x6427800e, 0x4d47bae0, 0x09fe548f,
+	0x83852d0f, 0x30362f1a, 0x7b5a9cc3, 0x31fec169,
+	0x9fec022a, 0x6c8dedc4, 0x15d6874d, 0x5fde7a4e,
+	0xbad90e37, 0x2e4e5eef, 0x4eaba214, 0xa8a472c0,
+	0x429a969e, 0x148d302a, 0xc40ba6d0, 0xc4e22c3c
+};
+
+/**
+ * Multiplies two polynomials modulo P, both in reflected representation.
+*/
+static uint32_t multmodp(uint32_t a, uint32_t b) {
+	uint32_t m = (uint32_t) 1 << 31, p = 0;
+
+	for(;;) {
+		if(a & m) {
+			p ^= b;
+			if((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ CRC32_REVERSED_POLYNOMIAL : b >> 1;
+	}
+
+	return p;
+}
 
-#define GF2_DIM 32      /* dimension of GF(2) vectors (length of CRC) */
+/**
+ * Returns x^(n * 2^k) mod P.
+*/
+static uint32_t x2nmodp(uint64_t n, unsigned k) {
+	uint32_t p = (uint32_t) 1 << 31; 	// x^0
 
-static unsigned long gf2_matrix_times(unsigned long* mat, unsigned long vec) {
-    unsigned long sum;
+	for(; n; n >>= 1, k++)
+		if(n & 1)
+			p = multmodp(x2n_table[k % CRC32_X2N_TABLE_SIZE], p);
 
-    sum = 0;
-    while (vec) {
-        if (vec & 1)
-            sum ^= *mat;
-        vec >>= 1;
-        mat++;
-    }
-    return sum;
+	return p;
 }
 
-static void gf2_matrix_square(unsigned long* square, unsigned long* mat) {
-    int n;
+/* Header Implementations */
+
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length) {
+	return ~crc32_update_register(~crc, data, length);
+}
+
+uint32_t crc32_join_gen(uint64_t len2) {
+	// len2 bytes are 8 * len2 = len2 * 2^3 bits
+	return x2nmodp(len2, 3);
+}
 
-    for (n = 0; n < GF2_DIM; n++)
-        square[n] = gf2_matrix_times(mat, mat[n]);
+uint32_t crc32_join_op(uint32_t crc1, uint32_t crc2, uint32_t op) {
+	return multmodp(op, crc1) ^ crc2;
 }
 
-uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2){
-    int n;
-    unsigned long row;
-    unsigned long even[GF2_DIM];    /* even-power-of-two zeros operator */
-    unsigned long odd[GF2_DIM];     /* odd-power-of-two zeros operator */
-
-    /* degenerate case (also disallow negative lengths) */
-    if (len2 <= 0)
-        return crc1;
-
-    /* put operator for one zero bit in odd */
-    odd[0] = CRC32_REVERSED_POLYNOMIAL;          /* CRC-32 polynomial */
-    row = 1;
-    for (n = 1; n < GF2_DIM; n++) {
-        odd[n] = row;
-        row <<= 1;
-    }
-
-    /* put operator for two zero bits in even */
-    gf2_matrix_square(even, odd);
-
-    /* put operator for four zero bits in odd */
-    gf2_matrix_square(odd, even);
-
-    /* apply len2 zeros to crc1 (first square will put the operator for one
-       zero byte, eight zero bits, in even) */
-    do {
-        /* apply zeros operator for this bit of len2 */
-        gf2_matrix_square(even, odd);
-        if (len2 & 1)
-            crc1 = gf2_matrix_times(even, crc1);
-        len2 >>= 1;
-
-        /* if no more bits set, then done */
-        if (len2 == 0)
-            break;
-
-        /* another iteration of the loop with odd and even swapped */
-        gf2_matrix_square(odd, even);
-        if (len2 & 1)
-            crc1 = gf2_matrix_times(odd, crc1);
-        len2 >>= 1;
-
-        /* if no more bits set, then done */
-    } while (len2 != 0);
-
-    /* return combined crc */
-    crc1 ^= crc2;
-    return crc1;
+uint32_t crc32_join(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+	return crc32_join_op(crc1, crc2, crc32_join_gen(len2));
 }
@@ -2,16 +2,49 @@
 #define _CRC32_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define CRC32_INITIAL_VALUE 	  0xFFFFFFFF
 #define CRC32_REVERSED_POLYNOMIAL 0xEDB88320
 
+/**
+ * Updates the specified CRC32 value with the specified data and returns the result.
+ * Start with a CRC32 value of 0 to calculate the CRC32 of new data.
+ * 
+ * @param crc the CRC32 value of the preceding data
+ * @param data the data to update the CRC32 value with
+ * @param length the number of bytes of data
+ * @return the updated CRC32 value
+*/
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length);
+
 /**
  * Combines two specified CRC32 values.
  * 
  * @param crc1 the first CRC32 value
  * @param crc2 the second CRC32 value
+ * @param len2 the length of the data the second CRC32 value was calculated from
+ * @return the CRC32 value of both data combined
+*/
+uint32_t crc32_join(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/**
+ * Returns the operator that combines CRC32 values of data followed by len2 bytes, to be
+ * used with crc32_join_op. Allows reusing the operator for many equally sized chunks.
+ * 
+ * @param len2 the length of the data the second CRC32 values are calculated from
+ * @return the combination operator
+*/
+uint32_t crc32_join_gen(uint64_t len2);
+
+/**
+ * Combines two specified CRC32 values using an operator returned by crc32_join_gen.
+ * 
+ * @param crc1 the first CRC32 value
+ * @param crc2 the second CRC32 value
+ * @param op the operator for the length of the data the second CRC32 value was calculated from
+ * @return the CRC32 value of both data combined
 */
-uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+uint32_t crc32_join_op(uint32_t crc1, uint32_t crc2, uint32_t op);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,97 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "crc32.h"
+#include "crc32_simd.h"
+
+/*
+ * Checks the CRC32 implementations against a bit-at-a-time reference on random data,
+ * lengths, alignments and initial registers. Exits with 1 on the first mismatch.
+ * Usage: crc32_check [seed]
+ */
+
+#define ROUNDS 				2000
+#define MAX_LENGTH 			8192
+#define MAX_MISALIGNMENT 	64
+#define SWEPT_LENGTHS 		512 	// the first rounds cover every length around the kernels' minimums
+
+static uint64_t rng_state;
+
+
+/* Helper Functions */
+
+static uint64_t next_random() {
+	// xorshift64*
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1D;
+}
+
+/**
+ * Updates a CRC32 register (not pre or post inverted) one bit at a time.
+*/
+static uint32_t reference_update_register(uint32_t crc, const uint8_t* data, size_t length) {
+	while(length--) {
+		crc ^= *data++;
+		for(unsigned char j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (CRC32_REVERSED_POLYNOMIAL & -(crc & 1));
+	}
+
+	return crc;
+}
+
+static bool check(const char* name, uint32_t crc, uint32_t expected, size_t misalignment, size_t length) {
+	if(crc == expected)
+		return true;
+
+	fprintf(stderr, "%s: got %08x, expected %08x (misalignment %zu, length %zu)\n", name, crc, expected, misalignment, length);
+	return false;
+}
+
+
+/* Main Functions */
+
+int main(int argc, char** argv) {
+	rng_state = argc > 1 ? strtoull(argv[1], NULL, 0) : 0x4D795A6970706572;
+	if(rng_state == 0)
+		rng_state = 1;
+
+	uint8_t* buffer = malloc(MAX_MISALIGNMENT + MAX_LENGTH);
+	if(buffer == NULL)
+		return 1;
+
+	for(size_t i = 0; i < MAX_MISALIGNMENT + MAX_LENGTH; i++)
+		buffer[i] = next_random();
+
+#ifdef CRC32_SIMD_SUPPORTED
+	bool pclmul = crc32_pclmul_supported(), vpclmul = crc32_vpclmul_supported();
+	printf("PCLMULQDQ kernel: %s, VPCLMULQDQ kernel: %s\n", pclmul ? "checked" : "unsupported", vpclmul ? "checked" : "unsupported");
+#endif
+
+	bool ok = true;
+	for(unsigned round = 0; round < ROUNDS && ok; round++) {
+		size_t misalignment = next_random() % MAX_MISALIGNMENT;
+		size_t length = round < SWEPT_LENGTHS ? round : next_random() % (MAX_LENGTH + 1);
+		uint32_t crc = next_random();
+		const uint8_t* data = buffer + misalignment;
+
+		// Whichever implementation crc32_update selected, including the tails the kernels leave to the tables
+		ok = check("crc32_update", crc32_update(crc, data, length), ~reference_update_register(~crc, data, length), misalignment, length);
+
+#ifdef CRC32_SIMD_SUPPORTED
+		// The kernels on their own, with lengths they accept
+		size_t folded_length = length & ~(size_t) 15;
+		uint32_t expected = reference_update_register(crc, data, folded_length);
+
+		if(ok && pclmul && folded_length >= CRC32_PCLMUL_MIN_LENGTH)
+			ok = check("crc32_pclmul", crc32_pclmul(crc, data, folded_length), expected, misalignment, folded_length);
+		if(ok && vpclmul && folded_length >= CRC32_VPCLMUL_MIN_LENGTH)
+			ok = check("crc32_vpclmul", crc32_vpclmul(crc, data, folded_length), expected, misalignment, folded_length);
+#endif
+	}
+
+	free(buffer);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+#include "crc32_simd.h"
+
+#ifdef CRC32_SIMD_SUPPORTED
+
+#include <immintrin.h>
+
+#define PCLMUL_TARGET 	__attribute__((target("pclmul,sse4.1")))
+#define VPCLMUL_TARGET 	__attribute__((target("avx512f,avx512vl,vpclmulqdq,pclmul,sse4.1")))
+
+/*
+ * Folding constants, see Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ".
+ * Kn is x^n mod P, bit-reflected and shifted left by one. Folding a 128-bit lane forward by
+ * D bits multiplies its low half by K(D+32) and its high half by K(D-32).
+ */
+#define K2080 	0x11542778aULL
+#define K2016 	0x1322d1430ULL
+#define K544 	0x154442bd4ULL
+#define K480 	0x1c6e41596ULL
+#define K416 	0x03db1ecdcULL
+#define K352 	0x174359406ULL
+#define K288 	0x0f1da05aaULL
+#define K224 	0x15a546366ULL
+#define K160 	0x1751997d0ULL
+#define K96 	0x0ccaa009eULL
+#define K64 	0x163cd6124ULL
+
+// Barrett reduction constants: P' (the reflected polynomial) and mu
+#define P_PRIME 0x1db710641ULL
+#define MU 		0x1f7011641ULL
+
+
+/* Helper Functions */
+
+static inline PCLMUL_TARGET __m128i fold_128(__m128i x, __m128i k, __m128i data) {
+	__m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+	__m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+	return _mm_xor_si128(_mm_xor_si128(lo, hi), data);
+}
+
+static inline VPCLMUL_TARGET __m512i fold_512(__m512i x, __m512i k, __m512i data) {
+	__m512i lo = _mm512_clmulepi64_epi128(x, k, 0x00);
+	__m512i hi = _mm512_clmulepi64_epi128(x, k, 0x11);
+	return _mm512_ternarylogic_epi64(lo, hi, data, 0x96); 	// lo ^ hi ^ data
+}
+
+/**
+ * Folds the remaining 16-byte blocks into the specified 128-bit remainder and reduces it to
+ * the final 32-bit CRC32 register.
+*/
+static inline PCLMUL_TARGET uint32_t fold_tail(__m128i x, const uint8_t* data, size_t length) {
+	__m128i k = _mm_set_epi64x(K96, K160);
+
+	for(; length >= 16; data += 16, length -= 16)
+		x = fold_128(x, k, _mm_loadu_si128((const __m128i*) data));
+
+	// Fold 128 bits to 64 bits
+	__m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+	__m128i t = _mm_clmulepi64_si128(x, k, 0x10);
+	x = _mm_xor_si128(_mm_srli_si128(x, 8), t);
+
+	k = _mm_set_epi64x(0, K64);
+	t = _mm_srli_si128(x, 4);
+	x = _mm_clmulepi64_si128(_mm_and_si128(x, mask), k, 0x00);
+	x = _mm_xor_si128(x, t);
+
+	// Barrett reduce to 32 bits
+	k = _mm_set_epi64x(MU, P_PRIME);
+	t = _mm_clmulepi64_si128(_mm_and_si128(x, mask), k, 0x10);
+	t = _mm_clmulepi64_si128(_mm_and_si128(t, mask), k, 0x00);
+	x = _mm_xor_si128(x, t);
+
+	return _mm_extract_epi32(x, 1);
+}
+
+
+/* Header Implementations */
+
+bool crc32_pclmul_supported() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+
+bool crc32_vpclmul_supported() {
+	// Also checks that the operating system saves the AVX-512 state
+	__builtin_cpu_init();
+	return crc32_pclmul_supported() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+		&& __builtin_cpu_supports("vpclmulqdq");
+}
+
+PCLMUL_TARGET uint32_t crc32_pclmul(uint32_t crc, const uint8_t* data, size_t length) {
+	__m128i x0 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+	__m128i x1 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+	__m128i x2 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+	__m128i x3 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+	x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128(crc));
+
+	data += 64;
+	length -= 64;
+
+	// Fold 64 bytes per iteration
+	__m128i k = _mm_set_epi64x(K480, K544);
+	for(; length >= 64; data += 64, length -= 64) {
+		x0 = fold_128(x0, k, _mm_loadu_si128((const __m128i*)(data + 0x00)));
+		x1 = fold_128(x1, k, _mm_loadu_si128((const __m128i*)(data + 0x10)));
+		x2 = fold_128(x2, k, _mm_loadu_si128((const __m128i*)(data + 0x20)));
+		x3 = fold_128(x3, k, _mm_loadu_si128((const __m128i*)(data + 0x30)));
+	}
+
+	// Fold the four lanes into one
+	k = _mm_set_epi64x(K96, K160);
+	x0 = fold_128(x0, k, x1);
+	x0 = fold_128(x0, k, x2);
+	x0 = fold_128(x0, k, x3);
+
+	return fold_tail(x0, data, length);
+}
+
+VPCLMUL_TARGET uint32_t crc32_vpclmul(uint32_t crc, const uint8_t* data, size_t length) {
+	__m512i x0 = _mm512_loadu_si512(data + 0x00);
+	__m512i x1 = _mm512_loadu_si512(data + 0x40);
+	__m512i x2 = _mm512_loadu_si512(data + 0x80);
+	__m512i x3 = _mm512_loadu_si512(data + 0xC0);
+	x0 = _mm512_xor_si512(x0, _mm512_zextsi128_si512(_mm_cvtsi32_si128(crc)));
+
+	data += 256;
+	length -= 256;
+
+	// Fold 256 bytes per iteration
+	__m512i k = _mm512_broadcast_i32x4(_mm_set_epi64x(K2016, K2080));
+	for(; length >= 256; data += 256, length -= 256) {
+		x0 = fold_512(x0, k, _mm512_loadu_si512(data + 0x00));
+		x1 = fold_512(x1, k, _mm512_loadu_si512(data + 0x40));
+		x2 = fold_512(x2, k, _mm512_loadu_si512(data + 0x80));
+		x3 = fold_512(x3, k, _mm512_loadu_si512(data + 0xC0));
+	}
+
+	// Fold the four registers into one, then any remaining 64-byte blocks
+	k = _mm512_broadcast_i32x4(_mm_set_epi64x(K480, K544));
+	x0 = fold_512(x0, k, x1);
+	x0 = fold_512(x0, k, x2);
+	x0 = fold_512(x0, k, x3);
+
+	for(; length >= 64; data += 64, length -= 64)
+		x0 = fold_512(x0, k, _mm512_loadu_si512(data));
+
+	// Fold the first three 128-bit lanes onto the last one (by 384, 256 and 128 bits)
+	k = _mm512_set_epi64(0, 0, K96, K160, K224, K288, K352, K416);
+	__m512i t = _mm512_xor_si512(_mm512_clmulepi64_epi128(x0, k, 0x00), _mm512_clmulepi64_epi128(x0, k, 0x11));
+
+	__m128i x = _mm512_extracti32x4_epi32(x0, 3);
+	x = _mm_xor_si128(x, _mm512_extracti32x4_epi32(t, 0));
+	x = _mm_xor_si128(x, _mm512_extracti32x4_epi32(t, 1));
+	x = _mm_xor_si128(x, _mm512_extracti32x4_epi32(t, 2));
+
+	return fold_tail(x, data, length);
+}
+
+#endif
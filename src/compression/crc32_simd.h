@@ -0,0 +1,58 @@
+#ifndef _CRC32_SIMD_H
+#define _CRC32_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Carry-less multiplication CRC32 kernels for x86 processors.
+ * Use crc32_update (crc32.h), which selects the fastest kernel the processor supports.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#define CRC32_SIMD_SUPPORTED
+
+#define CRC32_PCLMUL_MIN_LENGTH 	64
+#define CRC32_VPCLMUL_MIN_LENGTH 	256
+
+/**
+ * Returns whether the processor supports the PCLMULQDQ kernel.
+ *
+ * @return whether the processor supports the PCLMULQDQ kernel
+*/
+bool crc32_pclmul_supported();
+
+/**
+ * Returns whether the processor and operating system support the AVX-512 VPCLMULQDQ kernel.
+ *
+ * @return whether the processor and operating system support the AVX-512 VPCLMULQDQ kernel
+*/
+bool crc32_vpclmul_supported();
+
+/**
+ * Updates the specified CRC32 register with the specified data using PCLMULQDQ folding.
+ * Unlike crc32_update, the register is neither pre nor post inverted.
+ *
+ * @param crc the CRC32 register
+ * @param data the data, at least CRC32_PCLMUL_MIN_LENGTH bytes long
+ * @param length the number of bytes of data, a multiple of 16
+ * @return the updated CRC32 register
+*/
+uint32_t crc32_pclmul(uint32_t crc, const uint8_t* data, size_t length);
+
+/**
+ * Updates the specified CRC32 register with the specified data using AVX-512 VPCLMULQDQ folding.
+ * Unlike crc32_update, the register is neither pre nor post inverted.
+ *
+ * @param crc the CRC32 register
+ * @param data the data, at least CRC32_VPCLMUL_MIN_LENGTH bytes long
+ * @param length the number of bytes of data, a multiple of 16
+ * @return the updated CRC32 register
+*/
+uint32_t crc32_vpclmul(uint32_t crc, const uint8_t* data, size_t length);
+
+#endif
+
+#endif
@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zlib.h>
+#include "../concurrency.h"
+#include "../thread_pool.h"
+#include "../crc32.h"
+#include "../../wrapper_functions.h"
+#include "../compression.h"
+#include "../../utils.h"
+
+#define BUFFER_SIZE 64 * 1024
+
+#define RAW_DEFLATE_WINDOW_BITS -15 	// zip entries hold raw deflate streams, without zlib headers
+#define MEMORY_LEVEL 			8
+
+#define MIN_SIZE_FOR_CONCURRENCY 10 * 1024 * 1024	// 10 MB
+
+#define CHUNK_SIZE 			(1024 * 1024) 	// 1 MB
+#define DICTIONARY_SIZE 	(32 * 1024) 		// the deflate window
+#define SLOTS_PER_THREAD 	2
+
+
+typedef struct {
+	HANDLE hOrigin;
+	uint64_t file_size, num_chunks;
+} chunk_deflate_context;
+
+typedef struct {
+	const chunk_deflate_context* cdc;
+	uint64_t chunk;
+	z_stream strm;
+	unsigned char* in;
+	unsigned char* data;
+	size_t size, capacity;
+	uint32_t crc32;
+	wait_group wg;
+} deflate_chunk;
+
+static int compression_level = DEFLATE_DEFAULT_LEVEL;
+
+
+/* Helper Functions */
+
+static void init_deflate_stream(z_stream* strm) {
+	*strm = (z_stream) {0};
+	if(deflateInit2(strm, compression_level, Z_DEFLATED, RAW_DEFLATE_WINDOW_BITS, MEMORY_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+		exit_with_error("deflateInit2 error: %s\n", strm->msg ? strm->msg : "invalid parameters");
+}
+
+/**
+ * Compresses a chunk of the origin file into its slot. The chunk is primed with the last
+ * 32 KB of the previous one, so it may reference them just like a single stream would, and
+ * all chunks but the last end on a byte boundary with an empty stored block (sync flush).
+*/
+static void deflate_chunk_task(void* data) {
+	deflate_chunk* slot = (deflate_chunk*) data;
+	const chunk_deflate_context* cdc = slot->cdc;
+	z_stream* strm = &slot->strm;
+
+	uint64_t chunk_offset = slot->chunk * CHUNK_SIZE;
+	DWORD chunk_size = MIN(CHUNK_SIZE, cdc->file_size - chunk_offset);
+	DWORD dictionary_size = MIN(DICTIONARY_SIZE, chunk_offset);
+
+	if(_ReadFileAt(cdc->hOrigin, slot->in, dictionary_size + chunk_size, chunk_offset - dictionary_size) != dictionary_size + chunk_size)
+		exit_with_error("File changed while being read\n");
+	slot->crc32 = crc32_update(0, slot->in + dictionary_size, chunk_size);
+
+	deflateReset(strm);
+	if(dictionary_size > 0)
+		deflateSetDictionary(strm, slot->in, dictionary_size);
+
+	strm->next_in = slot->in + dictionary_size;
+	strm->avail_in = chunk_size;
+	int flush = slot->chunk == cdc->num_chunks - 1 ? Z_FINISH : Z_SYNC_FLUSH;
+	slot->size = 0;
+
+	do {
+		if(slot->size == slot->capacity) {
+			slot->capacity *= 2;
+			slot->data = Realloc(slot->data, slot->capacity);
+		}
+
+		strm->next_out = slot->data + slot->size;
+		strm->avail_out = slot->capacity - slot->size;
+		deflate(strm, flush);
+		slot->size = slot->capacity - strm->avail_out;
+	} while(strm->avail_out == 0);
+}
+
+/**
+ * Compresses a file in fixed size chunks on the thread pool, pigz style, and writes the chunks
+ * in order as a single deflate stream. The output doesn't depend on the number of cores.
+ *
+ * @param origin_name the name of the file to compress
+ * @param hDest the file to write the compressed data to
+ * @param dest_offset the offset in the destination file to start writing data to
+ * @param file_size the size of the file to compress
+ * @return the compressed size and the CRC32 of the file
+*/
+static compression_result deflate_compress_chunks(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size) {
+	compression_result cr = {0};
+
+	chunk_deflate_context cdc;
+	cdc.hOrigin = _CreateFile(origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	cdc.file_size = file_size;
+	cdc.num_chunks = (file_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	// Slot i % num_slots compresses chunk i, which bounds how far ahead of the writer compression gets
+	unsigned num_slots = MIN(num_cores() * SLOTS_PER_THREAD, cdc.num_chunks);
+	deflate_chunk* slots = Calloc(num_slots, sizeof(deflate_chunk));
+
+	for(unsigned i = 0; i < num_slots; i++) {
+		slots[i].cdc = &cdc;
+		slots[i].chunk = i;
+		init_deflate_stream(&slots[i].strm);
+		slots[i].in = Malloc(DICTIONARY_SIZE + CHUNK_SIZE);
+		slots[i].capacity = deflateBound(&slots[i].strm, CHUNK_SIZE);
+		slots[i].data = Malloc(slots[i].capacity);
+
+		thread_pool_submit(&slots[i].wg, deflate_chunk_task, slots + i);
+	}
+
+	// Write the chunks in order as they are completed, all but the last one have the same size
+	uint32_t combine_op = crc32_join_gen(CHUNK_SIZE);
+	for(uint64_t i = 0; i < cdc.num_chunks; i++) {
+		deflate_chunk* slot = slots + i % num_slots;
+		wait_group_wait(&slot->wg);
+
+		_WriteFileAt(hDest, slot->data, slot->size, dest_offset + cr.destination_size);
+		cr.destination_size += slot->size;
+
+		if(i == 0)
+			cr.crc32 = slot->crc32;
+		else if(i < cdc.num_chunks - 1)
+			cr.crc32 = crc32_join_op(cr.crc32, slot->crc32, combine_op);
+		else
+			cr.crc32 = crc32_join(cr.crc32, slot->crc32, file_size - i * CHUNK_SIZE);
+
+		if(i + num_slots < cdc.num_chunks) {
+			slot->chunk = i + num_slots;
+			thread_pool_submit(&slot->wg, deflate_chunk_task, slot);
+		}
+	}
+
+	for(unsigned i = 0; i < num_slots; i++) {
+		deflateEnd(&slots[i].strm);
+		Free(slots[i].in);
+		Free(slots[i].data);
+	}
+	Free(slots);
+
+	_CloseHandle(cdc.hOrigin);
+	return cr;
+}
+
+
+/* Header Implementations */
+
+void deflate_set_level(int level) {
+	compression_level = level;
+}
+
+compression_result deflate_compress(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size) {
+	if(file_size > MIN_SIZE_FOR_CONCURRENCY)
+		return deflate_compress_chunks(origin_name, hDest, dest_offset, file_size);
+
+	compression_result cr = {0};
+
+	HANDLE hOrigin = _CreateFile(origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	z_stream strm;
+	init_deflate_stream(&strm);
+
+	unsigned char in[BUFFER_SIZE], out[BUFFER_SIZE];
+	uint64_t total_bytes_read = 0;
+	int flush;
+
+	do {
+		DWORD batch_size = MIN(BUFFER_SIZE, file_size - total_bytes_read);
+		if(_ReadFileAt(hOrigin, in, batch_size, total_bytes_read) != batch_size)
+			exit_with_error("File changed while being read\n");
+		total_bytes_read += batch_size;
+
+		cr.crc32 = crc32_update(cr.crc32, in, batch_size);
+
+		strm.next_in = in;
+		strm.avail_in = batch_size;
+		flush = total_bytes_read == file_size ? Z_FINISH : Z_NO_FLUSH;
+
+		// Compress the batch and write all output it produces
+		do {
+			strm.next_out = out;
+			strm.avail_out = BUFFER_SIZE;
+			deflate(&strm, flush);
+
+			DWORD output_size = BUFFER_SIZE - strm.avail_out;
+			_WriteFileAt(hDest, out, output_size, dest_offset + cr.destination_size);
+			cr.destination_size += output_size;
+		} while(strm.avail_out == 0);
+	} while(flush != Z_FINISH);
+
+	deflateEnd(&strm);
+
+	_CloseHandle(hOrigin);
+	return cr;
+}
+
+compression_result deflate_compress_buffer(const void* data, size_t size, unsigned char** out_data) {
+	compression_result cr = {0};
+	cr.crc32 = crc32_update(0, data, size);
+
+	z_stream strm;
+	init_deflate_stream(&strm);
+
+	// The bound fits the whole stream, so it is compressed in a single call
+	size_t capacity = deflateBound(&strm, size);
+	*out_data = Malloc(capacity);
+
+	strm.next_in = (Bytef*) data;
+	strm.avail_in = size;
+	strm.next_out = *out_data;
+	strm.avail_out = capacity;
+
+	if(deflate(&strm, Z_FINISH) != Z_STREAM_END)
+		exit_with_error("deflate error: %s\n", strm.msg ? strm.msg : "output buffer too small");
+
+	cr.destination_size = strm.total_out;
+	deflateEnd(&strm);
+	return cr;
+}
+
+decompression_result deflate_decompress(LPTSTR origin_name, LPTSTR dest_name, uint64_t origin_offset, uint64_t file_size) {
+	decompression_result dr = {0};
+
+	HANDLE hOrigin = _CreateFile(origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	HANDLE hDest = dest_name ? _CreateFile(dest_name, GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) : NULL;
+
+	z_stream strm = {0};
+	if(inflateInit2(&strm, RAW_DEFLATE_WINDOW_BITS) != Z_OK)
+		exit_with_error("inflateInit2 error: %s\n", strm.msg ? strm.msg : "invalid parameters");
+
+	unsigned char in[BUFFER_SIZE], out[BUFFER_SIZE];
+	uint64_t total_bytes_read = 0;
+	int ret = Z_OK;
+
+	while(ret != Z_STREAM_END && ret != Z_DATA_ERROR && total_bytes_read < file_size) {
+		DWORD batch_size = MIN(BUFFER_SIZE, file_size - total_bytes_read);
+		// The data is cut short, which leaves the stream unfinished
+		if(_ReadFileAt(hOrigin, in, batch_size, origin_offset + total_bytes_read) != batch_size)
+			break;
+		total_bytes_read += batch_size;
+
+		strm.next_in = in;
+		strm.avail_in = batch_size;
+
+		// Decompress the batch and write all output it produces
+		do {
+			strm.next_out = out;
+			strm.avail_out = BUFFER_SIZE;
+
+			// Corrupt data is reported to the caller, only running out of memory is fatal
+			ret = inflate(&strm, Z_NO_FLUSH);
+			if(ret == Z_NEED_DICT)
+				ret = Z_DATA_ERROR;
+			if(ret == Z_DATA_ERROR)
+				break;
+			if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+				exit_with_error("inflate error: %s\n", strm.msg ? strm.msg : "out of memory");
+
+			DWORD output_size = BUFFER_SIZE - strm.avail_out;
+			if(hDest)
+				_WriteFileAt(hDest, out, output_size, dr.destination_size);
+			dr.destination_size += output_size;
+
+			dr.crc32 = crc32_update(dr.crc32, out, output_size);
+		} while(strm.avail_out == 0 && ret != Z_STREAM_END);
+	}
+
+	// The stream must end exactly with the data
+	dr.valid = ret == Z_STREAM_END;
+
+	inflateEnd(&strm);
+
+	_CloseHandle(hOrigin);
+	if(hDest)
+		_CloseHandle(hDest);
+	return dr;
+}
@@ -1,124 +1,209 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include "../../zipper/zipper_file.h"
 #include "../concurrency.h"
+#include "../thread_pool.h"
 #include "../crc32.h"
 #include "../../wrapper_functions.h"
 #include "../compression.h"
 #include "../../utils.h"
 
-#define BUFFER_SIZE 4096
+#define BUFFER_SIZE 64 * 1024
 
 #define MIN_SIZE_FOR_CONCURRENCY 10 * 1024 * 1024	// 10 MB
 
 
 typedef struct {
-	LPWSTR origin_name, dest_name;
+	HANDLE hOrigin, hDest;
 	uint64_t origin_offset, dest_offset;
 	uint64_t num_bytes_to_write;
 	uint32_t crc32;
-} file_write_thread_data;
+	bool complete; 		// whether the whole chunk could be read
+} file_write_task_data;
 
-static DWORD WINAPI thread_file_write(void* data) {
-	file_write_thread_data* fwtd = (file_write_thread_data*) data;
-	uint32_t crc32 = CRC32_INITIAL_VALUE;
+static void file_write_task(void* data) {
+	file_write_task_data* fwtd = (file_write_task_data*) data;
+	uint32_t crc32 = 0;
 
-  	HANDLE hOrigin = _CreateFileW(fwtd->origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
-  	HANDLE hDest = _CreateFileW(fwtd->dest_name, GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
-	_SetFilePointerEx(hOrigin, (LARGE_INTEGER) {.QuadPart = fwtd->origin_offset}, NULL, FILE_BEGIN);
+	// Each task waits for its own writes, the destination file handle is shared
+	HANDLE hEvent = _CreateEvent(NULL, TRUE, FALSE, NULL);
 
 	unsigned char buffer[BUFFER_SIZE];
 	DWORD batch_size;
-    uint64_t total_bytes_written = 0, curr_offset = fwtd->dest_offset;
+    uint64_t total_bytes_written = 0, curr_origin_offset = fwtd->origin_offset, curr_dest_offset = fwtd->dest_offset;
 
 	while(total_bytes_written < fwtd->num_bytes_to_write) {
+		// Both files are accessed at explicit offsets so no file pointer is shared between tasks
 		OVERLAPPED overlapped = {0};
-		overlapped.Offset = curr_offset & 0xFFFFFFFF;
-		overlapped.OffsetHigh = curr_offset >> 32;
+		overlapped.Offset = curr_dest_offset & 0xFFFFFFFF;
+		overlapped.OffsetHigh = curr_dest_offset >> 32;
+		overlapped.hEvent = hEvent;
 
 		batch_size = MIN(BUFFER_SIZE, fwtd->num_bytes_to_write - total_bytes_written);
+
+		// Read data and write it asynchronously, a short read would leave the last batch's bytes in the buffer
+		if(_ReadFileAt(fwtd->hOrigin, buffer, batch_size, curr_origin_offset) != batch_size) {
+			fwtd->complete = false;
+			break;
+		}
+		_WriteFile(fwtd->hDest, buffer, batch_size, NULL, &overlapped);
+
 		total_bytes_written += batch_size;
-		curr_offset += batch_size;
+		curr_origin_offset += batch_size;
+		curr_dest_offset += batch_size;
+
+		// Calculate CRC32 while the write is in progress
+		crc32 = crc32_update(crc32, buffer, batch_size);
 
-		// Read data and write it asynchronously
-		_ReadFile(hOrigin, buffer, batch_size, NULL, NULL);	
-		_WriteFile(hDest, buffer, batch_size, NULL, &overlapped);
+		// Wait for the write to complete before the buffer is reused
+		_GetOverlappedResult(fwtd->hDest, &overlapped, &batch_size, TRUE);
+	}
+
+	fwtd->crc32 = crc32;
+
+	_CloseHandle(hEvent);
+}
 
-		// Calculate CRC32
-		for(DWORD i = 0; i < batch_size; i++) {
-			crc32 ^= buffer[i];
-			for(unsigned char j = 0; j < 8; j++)
-				crc32 = (crc32 >> 1) ^ (CRC32_REVERSED_POLYNOMIAL & -(crc32 & 1));
+/**
+ * Calculates the CRC32 of the task's chunk of the origin file, for data that is only checked or that the kernel
+ * copies without it passing through the process.
+*/
+static void file_crc32_task(void* data) {
+	file_write_task_data* fwtd = (file_write_task_data*) data;
+	uint32_t crc32 = 0;
+
+	unsigned char buffer[BUFFER_SIZE];
+	uint64_t total_bytes_read = 0;
+
+	while(total_bytes_read < fwtd->num_bytes_to_write) {
+		DWORD batch_size = MIN(BUFFER_SIZE, fwtd->num_bytes_to_write - total_bytes_read);
+		if(_ReadFileAt(fwtd->hOrigin, buffer, batch_size, fwtd->origin_offset + total_bytes_read) != batch_size) {
+			fwtd->complete = false;
+			break;
 		}
+		total_bytes_read += batch_size;
 
-		/*
-		 * It's fine to "wait" here instead of continuing with the next iteration because the CRC calculation
-		 * takes so much time that by the time it's done the write has already completed.
-		*/
-		_GetOverlappedResult(hDest, &overlapped, &batch_size, TRUE);
+		crc32 = crc32_update(crc32, buffer, batch_size);
 	}
 
-	fwtd->crc32 = ~crc32;
-
-	_CloseHandle(hOrigin);
-	_CloseHandle(hDest);
-  	return 0;
+	fwtd->crc32 = crc32;
 }
 
 /**
  * Writes the contents of a file to another file and returns the data's CRC32.
  * 
- * @param origin_name the name of the file to read data from
- * @param dest_name the name of the file to write data to
+ * @param hOrigin the file to read data from
+ * @param hDest the file to write data to, or NULL to only read the data
  * @param origin_offset the offset in the origin file to start reading data from
  * @param dest_offset the offset in the destination file to start writing data to
  * @param file_size the number of bytes to copy
+ * @param out_complete a pointer to a variable to receive whether all of the data could be read
 */
-static uint32_t file_write(LPWSTR origin_name, LPWSTR dest_name, uint64_t origin_offset, uint64_t dest_offset, uint64_t file_size) {
-	unsigned num_threads = file_size > MIN_SIZE_FOR_CONCURRENCY ? num_cores() : 1;
+static uint32_t file_write(HANDLE hOrigin, HANDLE hDest, uint64_t origin_offset, uint64_t dest_offset, uint64_t file_size, bool* out_complete) {
+	// Pipes can only be written in order
+	unsigned num_tasks = file_size > MIN_SIZE_FOR_CONCURRENCY && (hDest == NULL || _GetFileType(hDest) == FILE_TYPE_DISK) ? num_cores() : 1;
+
+	file_write_task_data tasks_data[num_tasks];
+	wait_group wg = WAIT_GROUP_INIT;
+
+	uint64_t bytes_per_task = file_size / num_tasks;
+	unsigned remainder = file_size % num_tasks;
+
+	for(unsigned i = 0; i < num_tasks; i++) {
+		tasks_data[i].hOrigin = hOrigin;
+		tasks_data[i].hDest = hDest;
+		tasks_data[i].origin_offset = origin_offset + bytes_per_task * i;
+		tasks_data[i].dest_offset = dest_offset + bytes_per_task * i;
+		tasks_data[i].num_bytes_to_write = bytes_per_task;
+		tasks_data[i].complete = true;
+		if(i == num_tasks - 1)
+			tasks_data[i].num_bytes_to_write += remainder;
+	}
+
+	// Without a destination the data is only read for its CRC32
+	bool copied = hDest == NULL;
 
-	file_write_thread_data threads_data[num_threads];
-	HANDLE threads[num_threads];
+#ifdef COPY_FILE_RANGE_SUPPORTED
+	// Let the kernel copy the data, possibly by just sharing the file system blocks, while the tasks read it through the
+	// page cache for its CRC32. The first block is copied on its own to find out whether the kernel can copy between the
+	// files at all, so the data is only read once either way: for its CRC32 here, or while it's copied by hand below
+	if(hDest != NULL) {
+		uint64_t probe_size = MIN(file_size, BUFFER_SIZE);
+		copied = _CopyFileRange(hOrigin, origin_offset, hDest, dest_offset, probe_size);
 
-	uint64_t bytes_per_thread = file_size / num_threads;
-	unsigned remainder = file_size % num_threads;
+		if(copied) {
+			for(unsigned i = 0; i < num_tasks; i++)
+				thread_pool_submit(&wg, file_crc32_task, tasks_data + i);
 
-	for(unsigned i = 0; i < num_threads; i++) {
-		threads_data[i].origin_name = origin_name;
-		threads_data[i].dest_name = dest_name;
-		threads_data[i].origin_offset = origin_offset + bytes_per_thread * i;
-		threads_data[i].dest_offset = dest_offset + bytes_per_thread * i;
-		threads_data[i].num_bytes_to_write = bytes_per_thread;
-		if(i == num_threads - 1)
-			threads_data[i].num_bytes_to_write += remainder;
+			// Once the first block was copied, failing to copy the rest is an error like any other
+			if(file_size > probe_size && !_CopyFileRange(hOrigin, origin_offset + probe_size, hDest, dest_offset + probe_size, file_size - probe_size))
+				exit_with_error("CopyFileRange error: %lu\n", GetLastError());
+
+			wait_group_wait(&wg);
+		}
+	}
+#endif
+
+	if(hDest == NULL) {
+		for(unsigned i = 0; i < num_tasks; i++)
+			thread_pool_submit(&wg, file_crc32_task, tasks_data + i);
+		wait_group_wait(&wg);
+	}
 
-		threads[i] = _CreateThread(NULL, 0, thread_file_write, threads_data + i, 0, NULL);
+	if(!copied) {
+		// A single task isn't worth handing over to the pool
+		if(num_tasks == 1)
+			file_write_task(tasks_data);
+		else {
+			for(unsigned i = 0; i < num_tasks; i++)
+				thread_pool_submit(&wg, file_write_task, tasks_data + i);
+			wait_group_wait(&wg);
+		}
 	}
 
-	_WaitForMultipleObjects(num_threads, threads, TRUE, INFINITE);
-	
-	for(unsigned i = 0; i < num_threads; i++)
-		_CloseHandle(threads[i]);
+	*out_complete = true;
+	for(unsigned i = 0; i < num_tasks; i++)
+		*out_complete &= tasks_data[i].complete;
 
-	// Calculate the final CRC32 value
-	uint32_t crc32 = threads_data[0].crc32;
-	for(unsigned i = 1; i < num_threads; i++)
-		crc32 = crc32_combine(crc32, threads_data[i].crc32, threads_data[i].num_bytes_to_write);
+	// Calculate the final CRC32 value, all chunks but the last one have the same size
+	uint32_t crc32 = tasks_data[0].crc32;
+	uint32_t combine_op = crc32_join_gen(bytes_per_task);
+	for(unsigned i = 1; i < num_tasks - 1; i++)
+		crc32 = crc32_join_op(crc32, tasks_data[i].crc32, combine_op);
+	if(num_tasks > 1)
+		crc32 = crc32_join(crc32, tasks_data[num_tasks - 1].crc32, tasks_data[num_tasks - 1].num_bytes_to_write);
 
 	return crc32;
 }
 
 
-compression_result no_compression_compress(LPWSTR origin_name, LPWSTR dest_name, uint64_t dest_offset, uint64_t file_size) {
+compression_result no_compression_compress(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size) {
 	compression_result cr;
 
+	HANDLE hOrigin = _CreateFile(origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	bool complete;
 	cr.destination_size = file_size;
-	cr.crc32 = file_write(origin_name, dest_name, 0, dest_offset, file_size);
+	cr.crc32 = file_write(hOrigin, hDest, 0, dest_offset, file_size, &complete);
+	if(!complete)
+		exit_with_error("File changed while being read\n");
 
+	_CloseHandle(hOrigin);
 	return cr;
 }
 
-uint32_t no_compression_decompress(LPWSTR origin_name, LPWSTR dest_name, uint64_t origin_offset, uint64_t file_size) {
-	return file_write(origin_name, dest_name, origin_offset, 0, file_size);
+decompression_result no_compression_decompress(LPTSTR origin_name, LPTSTR dest_name, uint64_t origin_offset, uint64_t file_size) {
+	decompression_result dr;
+
+	HANDLE hOrigin = _CreateFile(origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	HANDLE hDest = dest_name ? _CreateFile(dest_name, GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL) : NULL;
+
+	// Stored data can't be malformed, only its CRC32 can tell it's corrupt, unless the zip ends before it does
+	dr.destination_size = file_size;
+	dr.crc32 = file_write(hOrigin, hDest, origin_offset, 0, file_size, &dr.valid);
+
+	_CloseHandle(hOrigin);
+	if(hDest)
+		_CloseHandle(hDest);
+	return dr;
 }
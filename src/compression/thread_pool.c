@@ -0,0 +1,125 @@
+#include <stdbool.h>
+#include "thread_pool.h"
+#include "concurrency.h"
+#include "../wrapper_functions.h"
+
+typedef struct task task;
+
+struct task {
+	task_function function;
+	void* data;
+	wait_group* wg;
+	task* next;
+};
+
+typedef struct {
+	task *head, *tail;
+	CRITICAL_SECTION lock; 			// protects the queue and every wait group
+	CONDITION_VARIABLE changed; 	// signaled when a task is queued or a wait group is done
+} thread_pool;
+
+static thread_pool pool;
+static INIT_ONCE pool_created = INIT_ONCE_STATIC_INIT;
+
+
+/* Helper Functions */
+
+/**
+ * Removes and returns the task at the front of the queue, or NULL if it's empty.
+ * Must be called with the pool's lock held.
+*/
+static task* dequeue_task() {
+	task* t = pool.head;
+
+	if(t != NULL) {
+		pool.head = t->next;
+		if(pool.head == NULL)
+			pool.tail = NULL;
+	}
+
+	return t;
+}
+
+/**
+ * Runs the specified task and frees it. Must be called with the pool's lock held,
+ * which is released while the task runs.
+*/
+static void run_task(task* t) {
+	LeaveCriticalSection(&pool.lock);
+	t->function(t->data);
+	EnterCriticalSection(&pool.lock);
+
+	if(--t->wg->num_pending_tasks == 0)
+		WakeAllConditionVariable(&pool.changed);
+
+	Free(t);
+}
+
+static DWORD WINAPI worker_thread(void* data) {
+	EnterCriticalSection(&pool.lock);
+
+	while(true) {
+		task* t = dequeue_task();
+		if(t == NULL)
+			_SleepConditionVariableCS(&pool.changed, &pool.lock, INFINITE);
+		else
+			run_task(t);
+	}
+
+	return 0;
+}
+
+static BOOL WINAPI create_pool(PINIT_ONCE init_once, LPVOID parameter, LPVOID* context) {
+	InitializeCriticalSection(&pool.lock);
+	InitializeConditionVariable(&pool.changed);
+
+	// The workers live as long as the process does
+	for(DWORD i = 0; i < num_cores(); i++)
+		_CloseHandle(_CreateThread(NULL, 0, worker_thread, NULL, 0, NULL));
+
+	return TRUE;
+}
+
+
+/* Header Implementations */
+
+void thread_pool_submit(wait_group* wg, task_function function, void* data) {
+	// Several threads may submit the first tasks at once
+	_InitOnceExecuteOnce(&pool_created, create_pool, NULL, NULL);
+
+	task* t = Malloc(sizeof(task));
+	t->function = function;
+	t->data = data;
+	t->wg = wg;
+	t->next = NULL;
+
+	EnterCriticalSection(&pool.lock);
+
+	if(pool.tail == NULL)
+		pool.head = t;
+	else
+		pool.tail->next = t;
+	pool.tail = t;
+
+	wg->num_pending_tasks++;
+
+	// Waiting threads sleep on the same condition, make sure one that can run the task wakes up
+	WakeAllConditionVariable(&pool.changed);
+	LeaveCriticalSection(&pool.lock);
+}
+
+void wait_group_wait(wait_group* wg) {
+	_InitOnceExecuteOnce(&pool_created, create_pool, NULL, NULL);
+
+	EnterCriticalSection(&pool.lock);
+
+	while(wg->num_pending_tasks > 0) {
+		task* t = dequeue_task();
+		if(t == NULL)
+			_SleepConditionVariableCS(&pool.changed, &pool.lock, INFINITE);
+		else
+			run_task(t);
+	}
+
+	LeaveCriticalSection(&pool.lock);
+}
@@ -0,0 +1,36 @@
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include "../platform.h"
+
+/*
+ * Process-wide pool of num_cores() worker threads, created by the first submission or wait.
+ * Tasks are grouped by wait groups. Waiting threads run queued tasks themselves, so tasks
+ * may submit and wait for other tasks without exhausting the workers.
+ */
+
+typedef void (*task_function)(void* data);
+
+typedef struct {
+	unsigned num_pending_tasks;
+} wait_group;
+
+#define WAIT_GROUP_INIT {0}
+
+/**
+ * Queues the specified task in the thread pool and adds it to the specified wait group.
+ * 
+ * @param wg the wait group to add the task to
+ * @param function the function to run
+ * @param data the argument to run the function with
+*/
+void thread_pool_submit(wait_group* wg, task_function function, void* data);
+
+/**
+ * Waits until every task in the specified wait group is done, running queued tasks meanwhile.
+ * 
+ * @param wg the wait group to wait for
+*/
+void wait_group_wait(wait_group* wg);
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zstd.h>
+#include "../concurrency.h"
+#include "../crc32.h"
+#include "../../wrapper_functions.h"
+#include "../compression.h"
+#include "../../utils.h"
+
+#define BUFFER_SIZE 128 * 1024
+
+#define MIN_SIZE_FOR_CONCURRENCY 10 * 1024 * 1024	// 10 MB
+
+
+static int compression_level = ZSTANDARD_DEFAULT_LEVEL;
+
+/* Helper Functions */
+
+static void check_zstd_result(size_t result, const char* function_name) {
+	if(ZSTD_isError(result))
+		exit_with_error("%s error: %s\n", function_name, ZSTD_getErrorName(result));
+}
+
+static ZSTD_CCtx* create_compression_context(uint64_t file_size) {
+	ZSTD_CCtx* cctx = ZSTD_createCCtx();
+	if(cctx == NULL)
+		exit_with_error("ZSTD_createCCtx error\n");
+
+	check_zstd_result(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, compression_level), "ZSTD_CCtx_setParameter");
+	check_zstd_result(ZSTD_CCtx_setPledgedSrcSize(cctx, file_size), "ZSTD_CCtx_setPledgedSrcSize");
+	return cctx;
+}
+
+
+/* Header Implementations */
+
+void zstd_set_level(int level) {
+	compression_level = level;
+}
+
+compression_result zstd_compress(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size) {
+	compression_result cr = {0};
+
+	HANDLE hOrigin = _CreateFile(origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	ZSTD_CCtx* cctx = create_compression_context(file_size);
+
+	// Large files are compressed by zstd's own worker threads, whose output doesn't depend on their number.
+	// This fails if the library was built without multithreading support, which only makes it slower
+	if(file_size > MIN_SIZE_FOR_CONCURRENCY)
+		ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, num_cores());
+
+	unsigned char in[BUFFER_SIZE], out[BUFFER_SIZE];
+	uint64_t total_bytes_read = 0;
+	ZSTD_EndDirective mode;
+	size_t remaining;
+
+	do {
+		DWORD batch_size = MIN(BUFFER_SIZE, file_size - total_bytes_read);
+		if(_ReadFileAt(hOrigin, in, batch_size, total_bytes_read) != batch_size)
+			exit_with_error("File changed while being read\n");
+		total_bytes_read += batch_size;
+
+		cr.crc32 = crc32_update(cr.crc32, in, batch_size);
+
+		ZSTD_inBuffer input = {in, batch_size, 0};
+		mode = total_bytes_read == file_size ? ZSTD_e_end : ZSTD_e_continue;
+
+		// Compress the batch and write all output it produces, the frame is complete once nothing remains
+		do {
+			ZSTD_outBuffer output = {out, BUFFER_SIZE, 0};
+			remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+			check_zstd_result(remaining, "ZSTD_compressStream2");
+
+			_WriteFileAt(hDest, out, output.pos, dest_offset + cr.destination_size);
+			cr.destination_size += output.pos;
+		} while(mode == ZSTD_e_end ? remaining != 0 : input.pos < input.size);
+	} while(mode != ZSTD_e_end);
+
+	ZSTD_freeCCtx(cctx);
+
+	_CloseHandle(hOrigin);
+	return cr;
+}
+
+compression_result zstd_compress_buffer(const void* data, size_t size, unsigned char** out_data) {
+	compression_result cr = {0};
+	cr.crc32 = crc32_update(0, data, size);
+
+	ZSTD_CCtx* cctx = create_compression_context(size);
+
+	size_t capacity = ZSTD_compressBound(size);
+	*out_data = Malloc(capacity);
+
+	cr.destination_size = ZSTD_compress2(cctx, *out_data, capacity, data, size);
+	check_zstd_result(cr.destination_size, "ZSTD_compress2");
+
+	ZSTD_freeCCtx(cctx);
+	return cr;
+}
+
+decompression_result zstd_decompress(LPTSTR origin_name, LPTSTR dest_name, uint64_t origin_offset, uint64_t file_size) {
+	decompression_result dr = {0};
+
+	HANDLE hOrigin = _CreateFile(origin_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	HANDLE hDest = dest_name ? _CreateFile(dest_name, GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) : NULL;
+
+	ZSTD_DCtx* dctx = ZSTD_createDCtx();
+	if(dctx == NULL)
+		exit_with_error("ZSTD_createDCtx error\n");
+
+	unsigned char in[BUFFER_SIZE], out[BUFFER_SIZE];
+	uint64_t total_bytes_read = 0;
+	size_t remaining = 1;
+
+	while(remaining != 0 && !ZSTD_isError(remaining) && total_bytes_read < file_size) {
+		DWORD batch_size = MIN(BUFFER_SIZE, file_size - total_bytes_read);
+		// The data is cut short, which leaves the frame unfinished
+		if(_ReadFileAt(hOrigin, in, batch_size, origin_offset + total_bytes_read) != batch_size)
+			break;
+		total_bytes_read += batch_size;
+
+		ZSTD_inBuffer input = {in, batch_size, 0};
+		ZSTD_outBuffer output;
+
+		// Decompress the batch and write all output it produces, 0 is returned once the frame is complete
+		do {
+			output = (ZSTD_outBuffer) {out, BUFFER_SIZE, 0};
+			// Corrupt data is reported to the caller
+			remaining = ZSTD_decompressStream(dctx, &output, &input);
+			if(ZSTD_isError(remaining))
+				break;
+
+			if(hDest)
+				_WriteFileAt(hDest, out, output.pos, dr.destination_size);
+			dr.destination_size += output.pos;
+
+			dr.crc32 = crc32_update(dr.crc32, out, output.pos);
+		} while(remaining != 0 && (input.pos < input.size || output.pos == output.size));
+	}
+
+	// The frame must end exactly with the data
+	dr.valid = remaining == 0;
+
+	ZSTD_freeDCtx(dctx);
+
+	_CloseHandle(hOrigin);
+	if(hDest)
+		_CloseHandle(hDest);
+	return dr;
+}
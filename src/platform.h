@@ -0,0 +1,35 @@
+#ifndef _PLATFORM_H
+#define _PLATFORM_H
+
+/*
+ * Selects the platform backend behind the wrapper functions.
+ *
+ * Paths are handled as generic-text (TCHAR) strings: UTF-16 on Windows and native
+ * UTF-8 everywhere else, so no conversions are needed on POSIX systems.
+ */
+
+#ifdef _WIN32
+
+#ifndef UNICODE
+#define UNICODE
+#endif
+#ifndef _UNICODE
+#define _UNICODE
+#endif
+
+#include <windows.h>
+#include <tchar.h>
+
+#define PATH_SEPARATOR 	TEXT('\\')
+#define TSTR_FMT 		"%ls"
+
+#else
+
+#include "win32_posix.h"
+
+#define PATH_SEPARATOR 	TEXT('/')
+#define TSTR_FMT 		"%s"
+
+#endif
+
+#endif
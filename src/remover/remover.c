@@ -0,0 +1,548 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "../platform.h"
+#include "../zip.h"
+#include "../zip_index.h"
+#include "../wrapper_functions.h"
+#include "../utils.h"
+
+#define MOVE_BUFFER_SIZE 				16 * 1024 * 1024
+#define MAX_DEAD_SPACE_FRACTION 		16 		// collapsing may leave at most 1/16 as many bytes behind as it spares moving
+#define ZIP64_OFFSET_FIELD_MAX_SIZE 	(ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE + sizeof(uint64_t)) 	// added to a header whose offset no longer fits
+#define END_RECORDS_MAX_SIZE 			(sizeof(zip64_end_of_central_directory_record) + sizeof(zip64_end_of_central_directory_locator) + sizeof(end_of_central_directory_record))
+
+typedef struct {
+	uint64_t local_header_offset;
+	uint64_t entry;
+} entry_position;
+
+typedef struct {
+	LPTSTR zip_name;
+	HANDLE hZip;
+	zip_index* zi;
+
+	unsigned char* central_directory;
+	uint64_t central_directory_size;
+	uint64_t central_directory_start_offset;
+
+	bool* removed; 					// for each entry
+	uint64_t* header_offsets; 		// of each entry's header in the central directory
+	entry_position* order; 			// sorted by local header offset
+} remover_context;
+
+// A range of the zip, the entries after which move down by its size
+typedef struct {
+	uint64_t start, end;
+} removed_range;
+
+
+/* Helper Functions */
+
+static int compare_entry_positions(const void* a, const void* b) {
+	uint64_t offset_a = ((const entry_position*) a)->local_header_offset;
+	uint64_t offset_b = ((const entry_position*) b)->local_header_offset;
+	return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+/**
+ * Returns where the specified entry's bytes end: its local header, data and data descriptor, along
+ * with anything else up to the next entry or the central directory.
+*/
+static uint64_t entry_end(const remover_context* rc, uint64_t i) {
+	return i + 1 < rc->zi->num_entries ? rc->order[i + 1].local_header_offset : rc->central_directory_start_offset;
+}
+
+/**
+ * Marks the entry with the specified name to be removed, along with everything in it if it's a directory.
+*/
+static void mark_removed(remover_context* rc, LPTSTR file_name) {
+	if(_tcslen(file_name) >= MAX_PATH)
+		exit_with_error(TSTR_FMT " is too long\n", file_name);
+
+	char utf8_file_name[MAX_PATH];
+#ifdef UNICODE
+	_WideCharToMultiByte(CP_UTF8, 0, file_name, -1, utf8_file_name, MAX_PATH, NULL, NULL);
+#else
+	_tcscpy(utf8_file_name, file_name);
+#endif
+
+	const zip_entry* ze = zip_index_lookup(rc->zi, utf8_file_name);
+	if(ze == NULL) {
+		printf(TSTR_FMT " not found in zip\n", file_name);
+		return;
+	}
+
+	rc->removed[ze - rc->zi->entries] = true;
+
+	if(zip_entry_is_directory(rc->zi, ze))
+		for(uint64_t i = 0; i < rc->zi->num_entries; i++)
+			if(!strncmp(zip_entry_name(rc->zi, rc->zi->entries + i), utf8_file_name, ze->name_length))
+				rc->removed[i] = true;
+}
+
+/**
+ * Sorts the entries by their local header offset and returns whether they're laid out one after
+ * the other before the central directory, without overlapping.
+*/
+static bool order_entries(remover_context* rc) {
+	const zip_index* zi = rc->zi;
+
+	for(uint64_t i = 0; i < zi->num_entries; i++)
+		rc->order[i] = (entry_position){zi->entries[i].local_header_offset, i};
+	qsort(rc->order, zi->num_entries, sizeof(entry_position), compare_entry_positions);
+
+	for(uint64_t i = 0; i < zi->num_entries; i++) {
+		const zip_entry* ze = zi->entries + rc->order[i].entry;
+		if(entry_end(rc, i) <= ze->local_header_offset || ze->local_header_offset + sizeof(local_file_header) + ze->name_length + ze->compressed_size > entry_end(rc, i))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Returns the ranges taken by the removed entries, merging adjacent ones, and sets the number of ranges.
+*/
+static removed_range* find_removed_ranges(const remover_context* rc, size_t* out_num_ranges) {
+	removed_range* ranges = Malloc(MAX(rc->zi->num_entries, 1) * sizeof(removed_range));
+	size_t num_ranges = 0;
+
+	for(uint64_t i = 0; i < rc->zi->num_entries; i++) {
+		if(!rc->removed[rc->order[i].entry])
+			continue;
+
+		uint64_t start = rc->order[i].local_header_offset;
+		if(num_ranges > 0 && ranges[num_ranges - 1].end == start)
+			ranges[num_ranges - 1].end = entry_end(rc, i);
+		else
+			ranges[num_ranges++] = (removed_range){start, entry_end(rc, i)};
+	}
+
+	*out_num_ranges = num_ranges;
+	return ranges;
+}
+
+/**
+ * Returns the new offset of the data at the specified offset, which isn't in a removed range, once the ranges are removed.
+*/
+static uint64_t moved_offset(const removed_range* ranges, size_t num_ranges, uint64_t offset) {
+	uint64_t new_offset = offset;
+	for(size_t i = 0; i < num_ranges && ranges[i].end <= offset; i++)
+		new_offset -= ranges[i].end - ranges[i].start;
+	return new_offset;
+}
+
+/**
+ * Moves the data between the removed ranges down over them, in large sequential blocks from the first range on.
+ * Blocks only ever move down, so reading each one before writing it never overwrites data that's still to be moved.
+*/
+static void move_data(remover_context* rc, const removed_range* ranges, size_t num_ranges) {
+	unsigned char* buffer = Malloc(MOVE_BUFFER_SIZE);
+	uint64_t write_offset = ranges[0].start;
+
+	for(size_t i = 0; i < num_ranges; i++) {
+		uint64_t end = i + 1 < num_ranges ? ranges[i + 1].start : rc->central_directory_start_offset;
+
+		for(uint64_t read_offset = ranges[i].end; read_offset < end; ) {
+			DWORD size = MIN(end - read_offset, MOVE_BUFFER_SIZE);
+			if(_ReadFileAt(rc->hZip, buffer, size, read_offset) != size)
+				exit_with_error("Zip file is corrupt\n");
+
+			_WriteFileAt(rc->hZip, buffer, size, write_offset);
+			read_offset += size;
+			write_offset += size;
+		}
+	}
+
+	Free(buffer);
+}
+
+#ifdef COLLAPSE_RANGE_SUPPORTED
+/**
+ * Removes the whole file system blocks within the removed ranges, from the last one back, so the blocks after
+ * them are remapped instead of copied. What's left of the ranges around the blocks is zeroed and stays in the
+ * zip as unused space. This is only done if it leaves few bytes behind for how many it spares moving.
+ * Returns the ranges that were removed and sets their number, or returns NULL if nothing was removed.
+*/
+static removed_range* collapse_ranges(remover_context* rc, const removed_range* ranges, size_t num_ranges, size_t* out_num_collapsed) {
+	uint64_t block_size = _GetFileBlockSize(rc->hZip);
+	removed_range* collapsed = Malloc(num_ranges * sizeof(removed_range));
+	size_t num_collapsed = 0;
+	uint64_t removed_size = 0, collapsed_size = 0;
+
+	for(size_t i = 0; i < num_ranges; i++) {
+		uint64_t start = (ranges[i].start + block_size - 1) / block_size * block_size;
+		uint64_t end = ranges[i].end / block_size * block_size;
+
+		removed_size += ranges[i].end - ranges[i].start;
+		if(start < end) {
+			collapsed[num_collapsed++] = (removed_range){start, end};
+			collapsed_size += end - start;
+		}
+	}
+
+	uint64_t moved_size = rc->central_directory_start_offset - ranges[0].start - removed_size;
+	uint64_t dead_size = removed_size - collapsed_size;
+	if(num_collapsed == 0 || dead_size * MAX_DEAD_SPACE_FRACTION > moved_size) {
+		Free(collapsed);
+		return NULL;
+	}
+
+	// Zero the bytes that are left behind, so none of the removed entries can be found in them
+	unsigned char* zeros = Calloc(1, block_size);
+	for(size_t i = 0, j = 0; i < num_ranges; i++) {
+		uint64_t start = ranges[i].start;
+		for(; j < num_collapsed && collapsed[j].end <= ranges[i].end; j++) {
+			for(; start < collapsed[j].start; start += MIN(collapsed[j].start - start, block_size))
+				_WriteFileAt(rc->hZip, zeros, MIN(collapsed[j].start - start, block_size), start);
+			start = collapsed[j].end;
+		}
+		for(; start < ranges[i].end; start += MIN(ranges[i].end - start, block_size))
+			_WriteFileAt(rc->hZip, zeros, MIN(ranges[i].end - start, block_size), start);
+	}
+	Free(zeros);
+
+	// Only the first collapse can fail for lack of support, before anything moved
+	for(size_t i = num_collapsed; i-- > 0; )
+		if(!_CollapseFileRange(rc->hZip, collapsed[i].start, collapsed[i].end - collapsed[i].start)) {
+			if(i + 1 < num_collapsed)
+				exit_with_error("CollapseFileRange error: %lu\n", GetLastError());
+			Free(collapsed);
+			return NULL;
+		}
+
+	*out_num_collapsed = num_collapsed;
+	return collapsed;
+}
+#endif
+
+/**
+ * Copies the specified number of bytes within the zip, between ranges that don't overlap, inside the kernel if it can.
+*/
+static void copy_data(remover_context* rc, uint64_t from, uint64_t to, uint64_t size) {
+#ifdef COPY_FILE_RANGE_SUPPORTED
+	if(size == 0 || _CopyFileRange(rc->hZip, from, rc->hZip, to, size))
+		return;
+#endif
+
+	unsigned char* buffer = Malloc(MOVE_BUFFER_SIZE);
+
+	for(uint64_t copied_size = 0; copied_size < size; ) {
+		DWORD batch_size = MIN(size - copied_size, MOVE_BUFFER_SIZE);
+		if(_ReadFileAt(rc->hZip, buffer, batch_size, from + copied_size) != batch_size)
+			exit_with_error("Zip file is corrupt\n");
+
+		_WriteFileAt(rc->hZip, buffer, batch_size, to + copied_size);
+		copied_size += batch_size;
+	}
+
+	Free(buffer);
+}
+
+/**
+ * Copies the data between the removed ranges, in order and without the ranges, to the specified offset.
+*/
+static void stage_data(remover_context* rc, const removed_range* ranges, size_t num_ranges, uint64_t offset) {
+	for(size_t i = 0; i < num_ranges; i++) {
+		uint64_t end = i + 1 < num_ranges ? ranges[i + 1].start : rc->central_directory_start_offset;
+		copy_data(rc, ranges[i].end, offset, end - ranges[i].end);
+		offset += end - ranges[i].end;
+	}
+}
+
+/**
+ * Copies the specified central directory header to the specified buffer with the specified local header offset, and
+ * returns its new size. An offset that doesn't fit in the header goes in its zip64 extra field, which is added or
+ * grown for it if the offset wasn't there already.
+*/
+static uint64_t copy_central_directory_header(unsigned char* dest, const unsigned char* header, uint64_t header_size, uint64_t local_header_offset) {
+	memcpy(dest, header, header_size);
+	central_directory_header* cdh = (central_directory_header*) dest;
+
+	if(cdh->local_header_offset != 0xFFFFFFFF && local_header_offset < 0xFFFFFFFF) {
+		cdh->local_header_offset = local_header_offset;
+		return header_size;
+	}
+
+	// The zip64 extra field only holds the values that didn't fit, in this order, and was checked when indexing
+	unsigned char* extra_field = dest + sizeof(central_directory_header) + cdh->file_name_length;
+	uint16_t offset_pos = cdh->extra_field_length, data_size_pos = 0;
+	for(uint16_t pos = 0; pos + ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE <= cdh->extra_field_length; ) {
+		uint16_t header_id, data_size;
+		memcpy(&header_id, extra_field + pos, sizeof(uint16_t));
+		memcpy(&data_size, extra_field + pos + sizeof(uint16_t), sizeof(uint16_t));
+		pos += ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE;
+
+		if(header_id == ZIP64_EXTRA_FIELD_HEADER_ID) {
+			data_size_pos = pos - sizeof(uint16_t);
+			offset_pos = pos + sizeof(uint64_t) * ((cdh->uncompressed_size == 0xFFFFFFFF) + (cdh->compressed_size == 0xFFFFFFFF));
+			break;
+		}
+
+		pos += data_size;
+	}
+
+	if(cdh->local_header_offset == 0xFFFFFFFF) {
+		memcpy(extra_field + offset_pos, &local_header_offset, sizeof(uint64_t));
+		return header_size;
+	}
+
+	// Make room for the offset, and for the extra field's own header if the entry has none
+	uint16_t added_size = sizeof(uint64_t) + (data_size_pos == 0 ? ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE : 0);
+	if(cdh->extra_field_length + added_size > 0xFFFF)
+		exit_with_error("Extra field too large\n");
+
+	unsigned char* insert = extra_field + offset_pos;
+	memmove(insert + added_size, insert, dest + header_size - insert);
+
+	if(data_size_pos == 0) {
+		uint16_t field_header[] = {ZIP64_EXTRA_FIELD_HEADER_ID, sizeof(uint64_t)};
+		memcpy(insert, field_header, ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE);
+		insert += ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE;
+	} else {
+		uint16_t data_size;
+		memcpy(&data_size, extra_field + data_size_pos, sizeof(uint16_t));
+		data_size += sizeof(uint64_t);
+		memcpy(extra_field + data_size_pos, &data_size, sizeof(uint16_t));
+	}
+	memcpy(insert, &local_header_offset, sizeof(uint64_t));
+
+	cdh->extra_field_length += added_size;
+	cdh->local_header_offset = 0xFFFFFFFF;
+	cdh->version_needed_to_extract = MAX(cdh->version_needed_to_extract, ZIP_VERSION);
+	return header_size + added_size;
+}
+
+/**
+ * Writes the specified central directory and its end records at the specified offset, and returns where they end.
+ * The end records are built in the directory's buffer, which must have room for them, so that a single write
+ * extends the zip for directories smaller than the move buffer.
+*/
+static uint64_t write_directory(remover_context* rc, unsigned char* cd, uint64_t cd_size, uint64_t num_records, uint64_t offset) {
+	uint64_t size = cd_size;
+
+	// Add a zip64 end of central directory record (and locator) if necessary
+	if(num_records > 0xFFFF || cd_size > 0xFFFFFFFF || offset > 0xFFFFFFFF) {
+		zip64_end_of_central_directory_record z64eoccr;
+		create_zip64_end_of_central_directory_record(&z64eoccr, num_records, cd_size, offset);
+		zip64_end_of_central_directory_locator z64eoccl;
+		create_zip64_end_of_central_directory_locator(&z64eoccl, offset + cd_size);
+
+		memcpy(cd + size, &z64eoccr, sizeof(zip64_end_of_central_directory_record));
+		size += sizeof(zip64_end_of_central_directory_record);
+		memcpy(cd + size, &z64eoccl, sizeof(zip64_end_of_central_directory_locator));
+		size += sizeof(zip64_end_of_central_directory_locator);
+	}
+
+	end_of_central_directory_record eoccr;
+	create_end_of_central_directory_record(&eoccr, num_records, cd_size, offset);
+	memcpy(cd + size, &eoccr, sizeof(end_of_central_directory_record));
+	size += sizeof(end_of_central_directory_record);
+
+	for(uint64_t written_size = 0; written_size < size; ) {
+		DWORD batch_size = MIN(size - written_size, MOVE_BUFFER_SIZE);
+		_WriteFileAt(rc->hZip, cd + written_size, batch_size, offset + written_size);
+		written_size += batch_size;
+	}
+
+	return offset + size;
+}
+
+/**
+ * Writes a copy of the old central directory and its end records at the specified offset, and returns where they end.
+*/
+static uint64_t write_old_central_directory(remover_context* rc, uint64_t offset) {
+	unsigned char* cd = Malloc(rc->central_directory_size + END_RECORDS_MAX_SIZE);
+	memcpy(cd, rc->central_directory, rc->central_directory_size);
+
+	uint64_t end = write_directory(rc, cd, rc->central_directory_size, rc->zi->num_entries, offset);
+	Free(cd);
+	return end;
+}
+
+/**
+ * Writes the surviving entries' central directory headers and the end records at the specified offset, and returns
+ * where they end. The entries after the first removed range are pointed to where they're moved, or, while they're
+ * staged, the specified number of bytes past it.
+*/
+static uint64_t write_central_directory(remover_context* rc, const removed_range* ranges, size_t num_ranges, uint64_t staging_shift, uint64_t offset) {
+	const zip_index* zi = rc->zi;
+	unsigned char* cd = Malloc(rc->central_directory_size + zi->num_entries * ZIP64_OFFSET_FIELD_MAX_SIZE + END_RECORDS_MAX_SIZE);
+	uint64_t cd_size = 0, num_records = 0;
+
+	for(uint64_t i = 0; i < zi->num_entries; i++) {
+		if(rc->removed[i])
+			continue;
+
+		uint64_t header_size = (i + 1 < zi->num_entries ? rc->header_offsets[i + 1] : rc->central_directory_size) - rc->header_offsets[i];
+		uint64_t local_header_offset = zi->entries[i].local_header_offset;
+		uint64_t new_offset = moved_offset(ranges, num_ranges, local_header_offset) + (local_header_offset > ranges[0].start ? staging_shift : 0);
+
+		cd_size += copy_central_directory_header(cd + cd_size, rc->central_directory + rc->header_offsets[i], header_size, new_offset);
+		num_records++;
+	}
+
+	uint64_t end = write_directory(rc, cd, cd_size, num_records, offset);
+	Free(cd);
+	return end;
+}
+
+
+/**
+ * Removes the specified ranges so that every step leaves a readable zip behind, and the removal can be interrupted
+ * at any point. The data after the first removed entry is staged, already compacted, past the end of the zip, behind
+ * a central directory that points to it, and only then moved down over the removed entries. This writes that data
+ * twice and takes as much free space until it's done, which is what keeping a readable zip at the end of the file
+ * costs: a collapse or an in-place move changes offsets that the directory at the end still points to.
+*/
+static void remove_staged(remover_context* rc, const removed_range* ranges, size_t num_ranges) {
+	// The old central directory is first copied past where the staged data ends, so its end records stay at the end of
+	// the zip while the data is staged. Each step is flushed before the next one, which may overwrite what the zip only
+	// pointed to until then
+	LARGE_INTEGER zip_size;
+	_GetFileSizeEx(rc->hZip, &zip_size);
+
+	uint64_t data_end = moved_offset(ranges, num_ranges, rc->central_directory_start_offset);
+	uint64_t staging_offset = zip_size.QuadPart;
+	uint64_t staging_shift = staging_offset - ranges[0].start;
+	uint64_t old_directory_offset = staging_offset + data_end - ranges[0].start;
+
+	uint64_t old_directory_end = write_old_central_directory(rc, old_directory_offset);
+	_FlushFileBuffers(rc->hZip);
+
+	stage_data(rc, ranges, num_ranges, staging_offset);
+	_FlushFileBuffers(rc->hZip);
+
+	write_central_directory(rc, ranges, num_ranges, staging_shift, old_directory_end);
+	_FlushFileBuffers(rc->hZip);
+
+	// From here on the zip only points to the data before the first removed entry and to the staged data, which is
+	// moved down in one piece. The final central directory is written after it, still before the old end of the zip,
+	// and the zip is only cut off after it once it's on disk
+	copy_data(rc, staging_offset, ranges[0].start, data_end - ranges[0].start);
+	uint64_t zip_end = write_central_directory(rc, ranges, num_ranges, 0, data_end);
+	_FlushFileBuffers(rc->hZip);
+
+	_SetFilePointerEx(rc->hZip, (LARGE_INTEGER){.QuadPart = zip_end}, NULL, FILE_BEGIN);
+	_SetEndOfFile(rc->hZip);
+	_FlushFileBuffers(rc->hZip);
+}
+
+/**
+ * Removes the specified ranges in place, with no more bytes written than it takes to move the data after the first
+ * removed entry down once. Whole blocks are removed if the file system can, otherwise the data is moved by hand.
+ * The zip is damaged if this is interrupted, since the old central directory doesn't point to the moved entries.
+*/
+static void remove_in_place(remover_context* rc, removed_range* ranges, size_t num_ranges) {
+	removed_range* moved_ranges = NULL;
+	size_t num_moved_ranges = 0;
+#ifdef COLLAPSE_RANGE_SUPPORTED
+	moved_ranges = collapse_ranges(rc, ranges, num_ranges, &num_moved_ranges);
+#endif
+	if(moved_ranges == NULL) {
+		move_data(rc, ranges, num_ranges);
+		moved_ranges = ranges;
+		num_moved_ranges = num_ranges;
+	}
+
+	// The new central directory is only written once the data it points to is on disk, and the old one is cut off
+	// before, so it's never found past the new end records
+	_FlushFileBuffers(rc->hZip);
+
+	uint64_t data_end = moved_offset(moved_ranges, num_moved_ranges, rc->central_directory_start_offset);
+	_SetFilePointerEx(rc->hZip, (LARGE_INTEGER){.QuadPart = data_end}, NULL, FILE_BEGIN);
+	_SetEndOfFile(rc->hZip);
+
+	write_central_directory(rc, moved_ranges, num_moved_ranges, 0, data_end);
+	_FlushFileBuffers(rc->hZip);
+
+	if(moved_ranges != ranges)
+		Free(moved_ranges);
+}
+
+
+/* Main Functions */
+
+int _tmain(int argc, TCHAR* argv[]) {
+	int arg = 1;
+	bool in_place = false;
+
+	// Parse options: -f removes the entries in place, faster but not safe to interrupt
+	for(; arg < argc && argv[arg][0] == TEXT('-') && argv[arg][1] != TEXT('\0'); arg++) {
+		if(argv[arg][1] != TEXT('f') || argv[arg][2] != TEXT('\0')) {
+			argc = 0;
+			break;
+		}
+
+		in_place = true;
+	}
+
+	if(argc - arg < 2) {
+		printf("Usage: remover [-f] archive_name file_to_remove_1 ... file_to_remove_n\n");
+		return 0;
+	}
+
+	remover_context rc;
+	rc.zip_name = argv[arg++];
+	rc.hZip = _CreateFile(rc.zip_name, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	central_directory_location cdl;
+	if(!find_central_directory(rc.hZip, &cdl))
+		exit_with_error("End of central directory record not found\n");
+
+	rc.central_directory_size = cdl.central_directory_size;
+	rc.central_directory_start_offset = cdl.central_directory_start_offset;
+	rc.central_directory = load_central_directory(rc.hZip, cdl.central_directory_start_offset, cdl.central_directory_size);
+	rc.zi = rc.central_directory == NULL ? NULL : zip_index_parse(rc.central_directory, cdl.central_directory_size, cdl.num_records);
+	if(rc.zi == NULL)
+		exit_with_error("Zip file is corrupt\n");
+
+	uint64_t num_entries = rc.zi->num_entries;
+	rc.removed = Calloc(MAX(num_entries, 1), sizeof(bool));
+	rc.header_offsets = Malloc(MAX(num_entries, 1) * sizeof(uint64_t));
+	rc.order = Malloc(MAX(num_entries, 1) * sizeof(entry_position));
+
+	// The headers were checked when indexing, so they can be walked without checking them again
+	for(uint64_t i = 0, pos = 0; i < num_entries; i++) {
+		const central_directory_header* cdh = (const central_directory_header*)(rc.central_directory + pos);
+		rc.header_offsets[i] = pos;
+		pos += sizeof(central_directory_header) + cdh->file_name_length + cdh->extra_field_length + cdh->file_comment_length;
+	}
+
+	if(!order_entries(&rc))
+		exit_with_error("Zip file is corrupt\n");
+
+	for(; arg < argc; arg++)
+		mark_removed(&rc, argv[arg]);
+
+	size_t num_ranges;
+	removed_range* ranges = find_removed_ranges(&rc, &num_ranges);
+
+	if(num_ranges == 0) {
+		printf("Nothing to remove\n");
+		return 0;
+	}
+
+	for(uint64_t i = 0; i < num_entries; i++)
+		if(rc.removed[i])
+			printf("Removing %s\n", zip_entry_name(rc.zi, rc.zi->entries + i));
+
+	if(in_place)
+		remove_in_place(&rc, ranges, num_ranges);
+	else
+		remove_staged(&rc, ranges, num_ranges);
+
+	printf("Done\n");
+
+	Free(ranges);
+	Free(rc.order);
+	Free(rc.header_offsets);
+	Free(rc.removed);
+	Free(rc.central_directory);
+	zip_index_destroy(rc.zi);
+	_CloseHandle(rc.hZip);
+	return 0;
+}
@@ -3,131 +3,265 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
-#include <windows.h>
+#include "../platform.h"
 #include "../zip.h"
+#include "../zip_index.h"
 #include "../compression/compression.h"
+#include "../compression/concurrency.h"
+#include "../compression/thread_pool.h"
 #include "../wrapper_functions.h"
+#include "../utils.h"
+
+#define IN_FLIGHT_ENTRIES_PER_THREAD 	16
+
+typedef struct {
+	LPTSTR zip_name;
+	HANDLE hZip;
+	zip_index* zi;
+} unzipper_context;
+
+typedef struct {
+	const unzipper_context* uc;
+	const zip_entry* ze;
+} extraction_task_data;
 
 
 /* Helper Functions */
 
-static void create_directory(LPWSTR dir_name, uint16_t dir_attributes) {
-	if(!CreateDirectoryW(dir_name, NULL)) {
+static void create_directory(LPTSTR dir_name, uint16_t dir_attributes) {
+	if(!CreateDirectory(dir_name, NULL)) {
 		if(GetLastError() == ERROR_ALREADY_EXISTS)
 			return;
 
 		if(GetLastError() != ERROR_PATH_NOT_FOUND)
-			exit_with_error("CreateDirectoryW error: %lu\n", GetLastError());
+			exit_with_error("CreateDirectory error: %lu\n", GetLastError());
 
 		// Get the full path of the directory
-		WCHAR full_path[MAX_PATH];
-		_GetFullPathNameW(dir_name, MAX_PATH, full_path, NULL);
+		TCHAR full_path[MAX_PATH];
+		_GetFullPathName(dir_name, MAX_PATH, full_path, NULL);
 		
 		// Create the directory recursively
-		_SHCreateDirectoryExW(NULL, full_path, NULL);
+		_SHCreateDirectoryEx(NULL, full_path, NULL);
 	}
 
-	_SetFileAttributesW(dir_name, dir_attributes);
+	_SetFileAttributes(dir_name, dir_attributes);
 }
 
-static void create_file(LPWSTR file_name, uint16_t file_attributes) {
-	HANDLE hFile = CreateFileW(file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, file_attributes, NULL);
+static void create_file(LPTSTR file_name, uint16_t file_attributes) {
+	HANDLE hFile = CreateFile(file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, file_attributes, NULL);
 
 	if(hFile == INVALID_HANDLE_VALUE) {
 		if(GetLastError() != ERROR_PATH_NOT_FOUND)
-			exit_with_error("CreateFileW error: %lu\n", GetLastError());
+			exit_with_error("CreateFile error: %lu\n", GetLastError());
 
 		// Get the parent path of the file
-		WCHAR parent_path[MAX_PATH];
-		wcscpy(parent_path, file_name);
-		*wcsrchr(parent_path, L'/') = L'\0';
+		TCHAR parent_path[MAX_PATH];
+		_tcscpy(parent_path, file_name);
+		*_tcsrchr(parent_path, TEXT('/')) = TEXT('\0');
 		
 		// Create the parent directory and try to create the file again
 		create_directory(parent_path, FILE_ATTRIBUTE_DIRECTORY);
-		hFile = _CreateFileW(file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, file_attributes, NULL);
+		hFile = _CreateFile(file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, file_attributes, NULL);
 	}
 
 	_CloseHandle(hFile);
 }
 
 
+/**
+ * Converts the specified entry's name to a path, without its trailing slash, and returns whether it's a directory.
+*/
+static bool entry_path(const zip_index* zi, const zip_entry* ze, TCHAR out_path[MAX_PATH]) {
+	char utf8_file_name[MAX_PATH];
+
+	// Exclude trailing slash if present
+	bool has_trailing_slash = zip_entry_is_directory(zi, ze);
+	size_t name_length = MIN(ze->name_length - has_trailing_slash, MAX_PATH - 1);
+	memcpy(utf8_file_name, zip_entry_name(zi, ze), name_length);
+	utf8_file_name[name_length] = '\0';
+
+#ifdef UNICODE
+	_MultiByteToWideChar(CP_UTF8, 0, utf8_file_name, -1, out_path, MAX_PATH);
+#else
+	// Native names are UTF-8 and can be used as they are
+	_tcscpy(out_path, utf8_file_name);
+#endif
+
+	return has_trailing_slash || (ze->external_file_attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+
 /* Main Functions */
 
-void extract_file(LPWSTR zip_name, LPWSTR file_name, central_directory_header* cdr, local_file_header* lfh) {
-	if(cdr->external_file_attributes & FILE_ATTRIBUTE_DIRECTORY) {
-		create_directory(file_name, cdr->external_file_attributes & 0xFF);
+static void extract_file(LPTSTR zip_name, LPTSTR file_name, const zip_entry* ze, const local_file_header* lfh) {
+	create_file(file_name, ze->external_file_attributes & 0xFF);
+
+	if(ze->uncompressed_size == 0)
 		return;
+
+	uint64_t file_data_offset = ze->local_header_offset + sizeof(local_file_header) + lfh->file_name_length + lfh->extra_field_length;
+
+	decompression_result dr;
+	switch(ze->compression) {
+		case(NO_COMPRESSION): dr = no_compression_decompress(zip_name, file_name, file_data_offset, ze->compressed_size); break;
+		case(DEFLATE): dr = deflate_decompress(zip_name, file_name, file_data_offset, ze->compressed_size); break;
+#ifdef ZSTANDARD_SUPPORTED
+		case(ZSTANDARD): dr = zstd_decompress(zip_name, file_name, file_data_offset, ze->compressed_size); break;
+#endif
+		default: exit_with_error(TSTR_FMT " uses unsupported compression method %hu\n", file_name, ze->compression);
 	}
 
-	create_file(file_name, cdr->external_file_attributes & 0xFF);
+	if(!dr.valid || dr.destination_size != ze->uncompressed_size || dr.crc32 != ze->crc32)
+		exit_with_error(TSTR_FMT " is corrupt\n", file_name);
+}
+
+static void extraction_task(void* data) {
+	extraction_task_data* etd = (extraction_task_data*) data;
+	TCHAR file_name[MAX_PATH];
+	entry_path(etd->uc->zi, etd->ze, file_name);
 
-	if(cdr->uncompressed_size == 0)
-		return;
+	// Read local file header
+	local_file_header lfh;
+	if(_ReadFileAt(etd->uc->hZip, &lfh, sizeof(local_file_header), etd->ze->local_header_offset) != sizeof(local_file_header)
+			|| lfh.signature != LOCAL_FILE_HEADER_SIGNATURE)
+		exit_with_error(TSTR_FMT " is corrupt\n", file_name);
+
+	printf("Extracting " TSTR_FMT "\n", file_name);
+	extract_file(etd->uc->zip_name, file_name, etd->ze, &lfh);
+}
+
+/**
+ * Creates the directories of the specified entries, and the parents of their files, so the files
+ * can then be extracted in any order.
+*/
+static void create_directories(const unzipper_context* uc, const zip_entry** entries, size_t num_entries) {
+	TCHAR path[MAX_PATH], last_parent_path[MAX_PATH] = TEXT("");
+
+	for(size_t i = 0; i < num_entries; i++) {
+		if(entry_path(uc->zi, entries[i], path)) {
+			printf("Extracting " TSTR_FMT "\n", path);
+			create_directory(path, (entries[i]->external_file_attributes & 0xFF) | FILE_ATTRIBUTE_DIRECTORY);
+			continue;
+		}
 
-	uint64_t file_data_offset = cdr->local_header_offset + sizeof(local_file_header) + lfh->file_name_length + lfh->extra_field_length;
+		LPTSTR separator = _tcsrchr(path, TEXT('/'));
+		if(separator == NULL)
+			continue;
+		*separator = TEXT('\0');
 
-	switch(cdr->compression) {
-		case(NO_COMPRESSION): no_compression_decompress(zip_name, file_name, file_data_offset, cdr->compressed_size); break;
-		default: break;
+		// Entries are usually grouped by directory, skip the parent that was just created
+		if(_tcscmp(path, last_parent_path) != 0) {
+			create_directory(path, FILE_ATTRIBUTE_DIRECTORY);
+			_tcscpy(last_parent_path, path);
+		}
 	}
 }
 
-int main() {
-	int argc;
-	LPWSTR* argv = _CommandLineToArgvW(GetCommandLineW(), &argc);
+/**
+ * Extracts the files among the specified entries on the thread pool, keeping a bounded number of them in flight,
+ * and returns the number of bytes extracted. Large stored files are further split across cores by the codec.
+*/
+static uint64_t extract_files(const unzipper_context* uc, const zip_entry** entries, size_t num_entries) {
+	extraction_task_data* tasks_data = Malloc(MAX(num_entries, 1) * sizeof(extraction_task_data));
+	wait_group* wgs = Calloc(MAX(num_entries, 1), sizeof(wait_group));
+
+	size_t max_in_flight_entries = num_cores() * IN_FLIGHT_ENTRIES_PER_THREAD;
+	size_t next_entry = 0;
+	uint64_t total_size = 0;
+
+	for(size_t i = 0; i < num_entries; i++) {
+		// Schedule the following files, the waits below run them too
+		for(; next_entry < num_entries && next_entry < i + max_in_flight_entries; next_entry++) {
+			const zip_entry* ze = entries[next_entry];
+			if(zip_entry_is_directory(uc->zi, ze) || (ze->external_file_attributes & FILE_ATTRIBUTE_DIRECTORY))
+				continue;
+
+			tasks_data[next_entry] = (extraction_task_data) {uc, ze};
+			thread_pool_submit(wgs + next_entry, extraction_task, tasks_data + next_entry);
+			total_size += ze->uncompressed_size;
+		}
+
+		wait_group_wait(wgs + i);
+	}
+
+	Free(wgs);
+	Free(tasks_data);
+	return total_size;
+}
+
+int _tmain(int argc, TCHAR* argv[]) {
+	int arg = 1;
+
+	// Parse options: -j sets the number of threads, which defaults to the number of cores
+	for(; arg < argc && argv[arg][0] == TEXT('-') && argv[arg][1] != TEXT('\0'); arg++) {
+		LPTSTR threads_end;
+		long num_threads = 0;
 
-	if(argc != 2) {
-		printf("Usage: unzipper archive_name\n");
+		if(argv[arg][1] == TEXT('j') && argv[arg][2] == TEXT('\0') && arg + 1 < argc)
+			num_threads = _tcstol(argv[++arg], &threads_end, 10);
+
+		if(num_threads < 1 || *threads_end != TEXT('\0')) {
+			argc = 0;
+			break;
+		}
+
+		set_num_cores(num_threads);
+	}
+
+	if(argc - arg < 1) {
+		printf("Usage: unzipper [-j threads] archive_name [file_to_extract_1 ... file_to_extract_n]\n");
 		return 0;
 	}
 
-	LPWSTR zip_name = argv[1];
-	HANDLE hZip = _CreateFileW(zip_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	unzipper_context uc;
+	uc.zip_name = argv[arg++];
+	uc.hZip = _CreateFile(uc.zip_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 	
-	end_of_central_directory_record eocdr;
-	find_end_of_central_directory_record(zip_name, &eocdr);
+	central_directory_location cdl;
+	if(!find_central_directory(uc.hZip, &cdl))
+		exit_with_error("End of central directory record not found\n");
 
-	// Set file pointer to the start of the central directory
-	LARGE_INTEGER cdCursor = {.QuadPart = eocdr.central_directory_start_offset};
-	_SetFilePointerEx(hZip, cdCursor, NULL, FILE_BEGIN);
+	uc.zi = zip_index_load(uc.hZip, cdl.central_directory_start_offset, cdl.central_directory_size, cdl.num_records);
+	if(uc.zi == NULL)
+		exit_with_error("Zip file is corrupt\n");
 
-	central_directory_header cdr;
-	local_file_header lfh;
-	char utf8_file_name[MAX_PATH];
-	WCHAR utf16_file_name[MAX_PATH];
+	// Extract every entry, or only the ones that were named
+	size_t num_entries = 0;
+	const zip_entry** entries = Malloc(MAX(arg == argc ? uc.zi->num_entries : (uint64_t)(argc - arg), 1) * sizeof(zip_entry*));
 
-	// Iterate over the central directory records
-	for(uint16_t i = 0; i < eocdr.total_num_records; i++) {
-		// Read central directory header
-		_ReadFile(hZip, &cdr, sizeof(central_directory_header), NULL, NULL);
+	if(arg == argc)
+		for(; num_entries < uc.zi->num_entries; num_entries++)
+			entries[num_entries] = uc.zi->entries + num_entries;
+	else
+		for(; arg < argc; arg++) {
+			if(_tcslen(argv[arg]) >= MAX_PATH)
+				exit_with_error(TSTR_FMT " is too long\n", argv[arg]);
 
-		// Read the file name
-		_ReadFile(hZip, utf8_file_name, cdr.file_name_length, NULL, NULL);
+			char utf8_file_name[MAX_PATH];
+#ifdef UNICODE
+			_WideCharToMultiByte(CP_UTF8, 0, argv[arg], -1, utf8_file_name, MAX_PATH, NULL, NULL);
+#else
+			_tcscpy(utf8_file_name, argv[arg]);
+#endif
 
-		// Exclude trailing slash if present
-		if(utf8_file_name[cdr.file_name_length - 1] == '/') {
-			cdr.external_file_attributes |= FILE_ATTRIBUTE_DIRECTORY;
-			utf8_file_name[cdr.file_name_length - 1] = '\0';
+			const zip_entry* ze = zip_index_lookup(uc.zi, utf8_file_name);
+			if(ze == NULL)
+				printf(TSTR_FMT " not found in zip\n", argv[arg]);
+			else
+				entries[num_entries++] = ze;
 		}
-		else
-			utf8_file_name[cdr.file_name_length] = '\0';
-		
-		_MultiByteToWideChar(CP_UTF8, 0, utf8_file_name, -1, utf16_file_name, MAX_PATH);
 
-		// Read local file header
-		_SetFilePointerEx(hZip, (LARGE_INTEGER){.QuadPart = cdr.local_header_offset} , NULL, FILE_BEGIN);
-		_ReadFile(hZip, &lfh, sizeof(local_file_header), NULL, NULL);
+	ULONGLONG start_time = GetTickCount64();
 
-		printf("Extracting %ls\n", utf16_file_name);
-		extract_file(zip_name, utf16_file_name, &cdr, &lfh);
-
-		// Position FP onto the next central directory record
-		cdCursor.QuadPart += sizeof(central_directory_header) + cdr.file_name_length + cdr.extra_field_length + cdr.file_comment_length;
-		_SetFilePointerEx(hZip, cdCursor, NULL, FILE_BEGIN);
-	}
+	create_directories(&uc, entries, num_entries);
+	uint64_t total_size = extract_files(&uc, entries, num_entries);
 
-	printf("Done\n");
+	// Report the throughput, timing at least a millisecond
+	ULONGLONG elapsed_time = MAX(GetTickCount64() - start_time, 1);
+	printf("Done, extracted %.1f MB in %.3f s (%.1f MB/s)\n", total_size / 1e6, elapsed_time / 1e3, total_size / 1e3 / elapsed_time);
 
-	_CloseHandle(hZip);
+	Free(entries);
+	zip_index_destroy(uc.zi);
+	_CloseHandle(uc.hZip);
 	return 0;
 }
@@ -2,7 +2,7 @@
 #define _MACROS_H
 
 #include <stdint.h>
-#include <windows.h>
+#include "platform.h"
 
 #define MAX(a,b) \
 	({ __typeof__ (a) _a = (a); \
@@ -0,0 +1,888 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#endif
+#include "win32_posix.h"
+
+#define FILETIME_UNIX_EPOCH_OFFSET 	116444736000000000LL 	// 100 ns intervals between 1601-01-01 and 1970-01-01
+#define FILETIME_TICKS_PER_SECOND 	10000000LL
+
+#define MAX_KERNEL_COPY_SIZE 		(1 << 30) 	// bytes per copy_file_range and sendfile call, the kernel caps them below 2 GB
+
+typedef enum {
+	FILE_HANDLE,
+	THREAD_HANDLE,
+	FIND_HANDLE,
+	EVENT_HANDLE
+} handle_type;
+
+typedef struct {
+	handle_type type;
+	bool seekable; 		// file handles only, offsets are ignored for pipes and terminals like on Windows
+	union {
+		int fd;
+		struct {
+			pthread_t id;
+			bool joined;
+		} thread;
+		DIR* dir;
+	};
+} posix_handle;
+
+typedef struct {
+	LPTHREAD_START_ROUTINE start_address;
+	LPVOID parameter;
+} thread_start_data;
+
+static __thread DWORD last_error;
+
+// The arguments of the InitOnceExecuteOnce call whose function pthread_once is running
+static __thread struct {
+	PINIT_ONCE init_once;
+	PINIT_ONCE_FN function;
+	LPVOID parameter;
+	LPVOID* context;
+	BOOL result;
+} init_once_call;
+
+
+/* Helper Functions */
+
+static DWORD errno_to_error(int err) {
+	switch(err) {
+		case(0): 		return ERROR_SUCCESS;
+		case(ENOENT):
+		case(ENOTDIR): 	return ERROR_PATH_NOT_FOUND;
+		case(EMFILE):
+		case(ENFILE): 	return ERROR_TOO_MANY_OPEN_FILES;
+		case(EACCES):
+		case(EPERM):
+		case(EROFS): 	return ERROR_ACCESS_DENIED;
+		case(EBADF): 	return ERROR_INVALID_HANDLE;
+		case(ENOMEM): 	return ERROR_NOT_ENOUGH_MEMORY;
+		case(EEXIST): 	return ERROR_ALREADY_EXISTS;
+		case(EINVAL): 	return ERROR_INVALID_PARAMETER;
+		case(ENOSPC): 	return ERROR_DISK_FULL;
+		case(ENOTSUP): 	return ERROR_NOT_SUPPORTED;
+		default: 		return err; 	// no Win32 equivalent, report the errno value itself
+	}
+}
+
+static BOOL fail(DWORD error) {
+	last_error = error;
+	return FALSE;
+}
+
+static BOOL fail_with_errno() {
+	return fail(errno_to_error(errno));
+}
+
+static posix_handle* handle_create(handle_type type) {
+	posix_handle* h = calloc(1, sizeof(posix_handle));
+	if(h)
+		h->type = type;
+	return h;
+}
+
+static posix_handle* file_handle_create(int fd) {
+	posix_handle* h = handle_create(FILE_HANDLE);
+	if(h) {
+		h->fd = fd;
+		h->seekable = lseek(fd, 0, SEEK_CUR) != -1;
+	}
+	return h;
+}
+
+static void timespec_to_file_time(const struct timespec* ts, LPFILETIME out_ft) {
+	uint64_t ticks = ts->tv_sec * FILETIME_TICKS_PER_SECOND + ts->tv_nsec / 100 + FILETIME_UNIX_EPOCH_OFFSET;
+	out_ft->dwLowDateTime = ticks & 0xFFFFFFFF;
+	out_ft->dwHighDateTime = ticks >> 32;
+}
+
+static void file_time_to_timespec(const FILETIME* ft, struct timespec* out_ts) {
+	uint64_t ticks = ((uint64_t) ft->dwHighDateTime << 32 | ft->dwLowDateTime) - FILETIME_UNIX_EPOCH_OFFSET;
+	out_ts->tv_sec = ticks / FILETIME_TICKS_PER_SECOND;
+	out_ts->tv_nsec = ticks % FILETIME_TICKS_PER_SECOND * 100;
+}
+
+static void tm_to_system_time(const struct tm* tm, WORD milliseconds, LPSYSTEMTIME out_st) {
+	out_st->wYear = tm->tm_year + 1900;
+	out_st->wMonth = tm->tm_mon + 1;
+	out_st->wDayOfWeek = tm->tm_wday;
+	out_st->wDay = tm->tm_mday;
+	out_st->wHour = tm->tm_hour;
+	out_st->wMinute = tm->tm_min;
+	out_st->wSecond = tm->tm_sec;
+	out_st->wMilliseconds = milliseconds;
+}
+
+static DWORD mode_to_attributes(mode_t mode) {
+	DWORD attributes = 0;
+	if(S_ISDIR(mode))
+		attributes |= FILE_ATTRIBUTE_DIRECTORY;
+	if(!(mode & S_IWUSR))
+		attributes |= FILE_ATTRIBUTE_READONLY;
+
+	return attributes ? attributes : FILE_ATTRIBUTE_NORMAL;
+}
+
+static void set_find_data_size(uint64_t size, LPWIN32_FIND_DATA lpFindFileData) {
+	lpFindFileData->nFileSizeHigh = size >> 32;
+	lpFindFileData->nFileSizeLow = size & 0xFFFFFFFF;
+}
+
+/**
+ * Fills the specified find data's attributes, size and last write time with the ones of the file
+ * with the specified name in the directory, following symbolic links.
+*/
+static BOOL stat_directory_entry(DIR* dir, const char* name, LPWIN32_FIND_DATA lpFindFileData) {
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+	// Only ask for the fields that are used, which spares network file systems from fetching the rest
+	struct statx stx;
+	if(statx(dirfd(dir), name, AT_STATX_SYNC_AS_STAT, STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME, &stx) == -1)
+		return fail_with_errno();
+
+	struct timespec mtime = {stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec};
+	lpFindFileData->dwFileAttributes = mode_to_attributes(stx.stx_mode);
+	set_find_data_size(stx.stx_size, lpFindFileData);
+	timespec_to_file_time(&mtime, &lpFindFileData->ftLastWriteTime);
+#else
+	struct stat st;
+	if(fstatat(dirfd(dir), name, &st, 0) == -1)
+		return fail_with_errno();
+
+	lpFindFileData->dwFileAttributes = mode_to_attributes(st.st_mode);
+	set_find_data_size(st.st_size, lpFindFileData);
+	timespec_to_file_time(&st.st_mtim, &lpFindFileData->ftLastWriteTime);
+#endif
+
+	// Like on Windows, directories have no size
+	if(lpFindFileData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		set_find_data_size(0, lpFindFileData);
+
+	return TRUE;
+}
+
+/**
+ * Reads the next directory entry into the specified find data, skipping nothing (like
+ * Windows, "." and ".." are returned as well). The entry is stated relative to the directory,
+ * readdir itself reads the directory in large batches.
+*/
+static BOOL read_directory_entry(DIR* dir, LPWIN32_FIND_DATA lpFindFileData) {
+	errno = 0;
+	struct dirent* entry = readdir(dir);
+	if(entry == NULL)
+		return errno ? fail_with_errno() : fail(ERROR_NO_MORE_FILES);
+
+	snprintf(lpFindFileData->cFileName, MAX_PATH, "%s", entry->d_name);
+
+	// Entries that can't be stated, like broken symbolic links, are reported as empty files
+	if(!stat_directory_entry(dir, entry->d_name, lpFindFileData)) {
+		lpFindFileData->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+		set_find_data_size(0, lpFindFileData);
+		lpFindFileData->ftLastWriteTime = (FILETIME) {0, 0};
+	}
+
+	return TRUE;
+}
+
+static void* thread_start(void* data) {
+	thread_start_data tsd = *(thread_start_data*) data;
+	free(data);
+
+	return (void*)(uintptr_t) tsd.start_address(tsd.parameter);
+}
+
+
+/* Header Implementations */
+
+DWORD GetLastError(void) {
+	return last_error;
+}
+
+
+HANDLE CreateFile(LPCTSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile) {
+	int flags = O_CLOEXEC;
+
+	if((dwDesiredAccess & GENERIC_READ) && (dwDesiredAccess & GENERIC_WRITE))
+		flags |= O_RDWR;
+	else if(dwDesiredAccess & GENERIC_WRITE)
+		flags |= O_WRONLY;
+	else
+		flags |= O_RDONLY;
+
+	switch(dwCreationDisposition) {
+		case(CREATE_NEW): 			flags |= O_CREAT | O_EXCL; break;
+		case(CREATE_ALWAYS): 		flags |= O_CREAT | O_TRUNC; break;
+		case(OPEN_ALWAYS): 			flags |= O_CREAT; break;
+		case(TRUNCATE_EXISTING): 	flags |= O_TRUNC; break;
+		case(OPEN_EXISTING): 		break;
+		default: 					fail(ERROR_INVALID_PARAMETER); return INVALID_HANDLE_VALUE;
+	}
+
+	mode_t mode = dwFlagsAndAttributes & FILE_ATTRIBUTE_READONLY ? 0444 : 0666;
+
+	int fd = open(lpFileName, flags, mode);
+	if(fd == -1) {
+		if(errno == ENOENT && !(flags & O_CREAT))
+			fail(ERROR_FILE_NOT_FOUND);
+		else if(errno == EEXIST)
+			fail(ERROR_FILE_EXISTS);
+		else
+			fail_with_errno();
+		return INVALID_HANDLE_VALUE;
+	}
+
+	if(dwFlagsAndAttributes & FILE_FLAG_SEQUENTIAL_SCAN)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	else if(dwFlagsAndAttributes & FILE_FLAG_RANDOM_ACCESS)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+
+	posix_handle* h = file_handle_create(fd);
+	if(h == NULL) {
+		close(fd);
+		fail(ERROR_NOT_ENOUGH_MEMORY);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	return h;
+}
+
+HANDLE GetStdHandle(DWORD nStdHandle) {
+	int fd;
+	switch(nStdHandle) {
+		case(STD_INPUT_HANDLE): 	fd = STDIN_FILENO; break;
+		case(STD_OUTPUT_HANDLE): 	fd = STDOUT_FILENO; break;
+		case(STD_ERROR_HANDLE): 	fd = STDERR_FILENO; break;
+		default: 					fail(ERROR_INVALID_PARAMETER); return INVALID_HANDLE_VALUE;
+	}
+
+	// Closing the handle closes the stream, like on Windows
+	posix_handle* h = file_handle_create(fd);
+	if(h == NULL) {
+		fail(ERROR_NOT_ENOUGH_MEMORY);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	return h;
+}
+
+DWORD GetFileType(HANDLE hFile) {
+	posix_handle* h = hFile;
+	struct stat st;
+
+	if(fstat(h->fd, &st) == -1) {
+		fail_with_errno();
+		return FILE_TYPE_UNKNOWN;
+	}
+
+	last_error = ERROR_SUCCESS;
+
+	if(S_ISREG(st.st_mode) || S_ISBLK(st.st_mode))
+		return FILE_TYPE_DISK;
+	if(S_ISCHR(st.st_mode))
+		return FILE_TYPE_CHAR;
+	if(S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode))
+		return FILE_TYPE_PIPE;
+	return FILE_TYPE_UNKNOWN;
+}
+
+BOOL CloseHandle(HANDLE hObject) {
+	posix_handle* h = hObject;
+	int ret = 0;
+
+	if(h == NULL || h == INVALID_HANDLE_VALUE)
+		return fail(ERROR_INVALID_HANDLE);
+
+	switch(h->type) {
+		case(FILE_HANDLE): 		ret = close(h->fd); break;
+		case(FIND_HANDLE): 		ret = closedir(h->dir); break;
+		case(EVENT_HANDLE): 	break;
+		case(THREAD_HANDLE):
+			// The thread keeps running on its own if it was never waited for
+			if(!h->thread.joined)
+				ret = pthread_detach(h->thread.id);
+			break;
+	}
+
+	free(h);
+	return ret == 0 ? TRUE : fail_with_errno();
+}
+
+
+BOOL CreateDirectory(LPCTSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes) {
+	return mkdir(lpPathName, 0777) == 0 ? TRUE : fail_with_errno();
+}
+
+BOOL DeleteFile(LPCTSTR lpFileName) {
+	return unlink(lpFileName) == 0 ? TRUE : fail_with_errno();
+}
+
+BOOL MoveFileEx(LPCTSTR lpExistingFileName, LPCTSTR lpNewFileName, DWORD dwFlags) {
+	// rename always replaces the new file, so only hard link the file to its new name when it mustn't be replaced
+	if(dwFlags & MOVEFILE_REPLACE_EXISTING)
+		return rename(lpExistingFileName, lpNewFileName) == 0 ? TRUE : fail_with_errno();
+
+	if(link(lpExistingFileName, lpNewFileName) == -1)
+		return fail_with_errno();
+	return unlink(lpExistingFileName) == 0 ? TRUE : fail_with_errno();
+}
+
+int SHCreateDirectoryEx(HWND hwnd, LPCTSTR pszPath, const SECURITY_ATTRIBUTES *psa) {
+	size_t path_length = strlen(pszPath);
+	char path[path_length + 1];
+	memcpy(path, pszPath, path_length + 1);
+
+	// Ignore trailing slashes
+	while(path_length > 1 && path[path_length - 1] == '/')
+		path[--path_length] = '\0';
+
+	// Create every missing ancestor, then the directory itself
+	for(char* c = path + 1; *c; c++)
+		if(*c == '/') {
+			*c = '\0';
+			if(mkdir(path, 0777) == -1 && errno != EEXIST) {
+				fail_with_errno();
+				return last_error;
+			}
+			*c = '/';
+		}
+
+	if(mkdir(path, 0777) == -1) {
+		fail_with_errno();
+		return last_error;
+	}
+
+	return ERROR_SUCCESS;
+}
+
+DWORD GetFullPathName(LPCTSTR lpFileName, DWORD nBufferLength, LPTSTR lpBuffer, LPTSTR *lpFilePart) {
+	char cwd[MAX_PATH] = "";
+
+	if(lpFileName[0] != '/' && getcwd(cwd, MAX_PATH) == NULL) {
+		fail_with_errno();
+		return 0;
+	}
+
+	int length = snprintf(lpBuffer, nBufferLength, "%s%s%s", cwd, cwd[0] ? "/" : "", lpFileName);
+
+	// Return the required buffer size if it doesn't fit, like Windows does
+	if((DWORD) length >= nBufferLength)
+		return length + 1;
+
+	if(lpFilePart)
+		*lpFilePart = strrchr(lpBuffer, '/') + 1;
+
+	return length;
+}
+
+
+BOOL ReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped) {
+	posix_handle* h = hFile;
+	bool positional = lpOverlapped && h->seekable;
+	off_t offset = lpOverlapped ? (off_t)((uint64_t) lpOverlapped->OffsetHigh << 32 | lpOverlapped->Offset) : 0;
+	DWORD total_bytes_read = 0;
+
+	while(total_bytes_read < nNumberOfBytesToRead) {
+		uint8_t* buffer = (uint8_t*) lpBuffer + total_bytes_read;
+		size_t count = nNumberOfBytesToRead - total_bytes_read;
+
+		ssize_t bytes_read = positional ? pread(h->fd, buffer, count, offset + total_bytes_read) : read(h->fd, buffer, count);
+		if(bytes_read == -1) {
+			if(errno == EINTR)
+				continue;
+			return fail_with_errno();
+		}
+
+		// End of file
+		if(bytes_read == 0)
+			break;
+
+		total_bytes_read += bytes_read;
+	}
+
+	if(lpNumberOfBytesRead)
+		*lpNumberOfBytesRead = total_bytes_read;
+	if(lpOverlapped)
+		lpOverlapped->InternalHigh = total_bytes_read;
+
+	return TRUE;
+}
+
+BOOL WriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, LPDWORD lpNumberOfBytesWritten, LPOVERLAPPED lpOverlapped) {
+	posix_handle* h = hFile;
+	bool positional = lpOverlapped && h->seekable;
+	off_t offset = lpOverlapped ? (off_t)((uint64_t) lpOverlapped->OffsetHigh << 32 | lpOverlapped->Offset) : 0;
+	DWORD total_bytes_written = 0;
+
+	while(total_bytes_written < nNumberOfBytesToWrite) {
+		const uint8_t* buffer = (const uint8_t*) lpBuffer + total_bytes_written;
+		size_t count = nNumberOfBytesToWrite - total_bytes_written;
+
+		ssize_t bytes_written = positional ? pwrite(h->fd, buffer, count, offset + total_bytes_written) : write(h->fd, buffer, count);
+		if(bytes_written == -1) {
+			if(errno == EINTR)
+				continue;
+			return fail_with_errno();
+		}
+
+		total_bytes_written += bytes_written;
+	}
+
+	if(lpNumberOfBytesWritten)
+		*lpNumberOfBytesWritten = total_bytes_written;
+	if(lpOverlapped)
+		lpOverlapped->InternalHigh = total_bytes_written;
+
+	return TRUE;
+}
+
+
+BOOL SetFilePointerEx(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer, DWORD dwMoveMethod) {
+	posix_handle* h = hFile;
+
+	// FILE_BEGIN, FILE_CURRENT and FILE_END have the same values as SEEK_SET, SEEK_CUR and SEEK_END
+	off_t offset = lseek(h->fd, liDistanceToMove.QuadPart, dwMoveMethod);
+	if(offset == -1)
+		return fail_with_errno();
+
+	if(lpNewFilePointer)
+		lpNewFilePointer->QuadPart = offset;
+
+	return TRUE;
+}
+
+BOOL SetEndOfFile(HANDLE hFile) {
+	posix_handle* h = hFile;
+
+	off_t offset = lseek(h->fd, 0, SEEK_CUR);
+	if(offset == -1 || ftruncate(h->fd, offset) == -1)
+		return fail_with_errno();
+
+	return TRUE;
+}
+
+BOOL FlushFileBuffers(HANDLE hFile) {
+	posix_handle* h = hFile;
+	return fsync(h->fd) == 0 ? TRUE : fail_with_errno();
+}
+
+
+BOOL GetOverlappedResult(HANDLE hFile, LPOVERLAPPED lpOverlapped, LPDWORD lpNumberOfBytesTransferred, BOOL bWait) {
+	// Overlapped operations complete synchronously on POSIX systems
+	*lpNumberOfBytesTransferred = lpOverlapped->InternalHigh;
+	return TRUE;
+}
+
+
+DWORD GetFileAttributes(LPCTSTR lpFileName) {
+	struct stat st;
+	if(stat(lpFileName, &st) == -1) {
+		fail_with_errno();
+		return INVALID_FILE_ATTRIBUTES;
+	}
+
+	return mode_to_attributes(st.st_mode);
+}
+
+BOOL SetFileAttributes(LPCTSTR lpFileName, DWORD dwFileAttributes) {
+	struct stat st;
+	if(stat(lpFileName, &st) == -1)
+		return fail_with_errno();
+
+	// Only the read-only attribute has a POSIX equivalent
+	mode_t mode = dwFileAttributes & FILE_ATTRIBUTE_READONLY ? st.st_mode & ~(S_IWUSR | S_IWGRP | S_IWOTH) : st.st_mode | S_IWUSR;
+	if(mode != st.st_mode && chmod(lpFileName, mode & 07777) == -1)
+		return fail_with_errno();
+
+	return TRUE;
+}
+
+
+BOOL GetFileTime(HANDLE hFile, LPFILETIME lpCreationTime, LPFILETIME lpLastAccessTime, LPFILETIME lpLastWriteTime) {
+	posix_handle* h = hFile;
+	struct stat st;
+	if(fstat(h->fd, &st) == -1)
+		return fail_with_errno();
+
+	// POSIX has no creation time, the last status change is the closest equivalent
+	if(lpCreationTime)
+		timespec_to_file_time(&st.st_ctim, lpCreationTime);
+	if(lpLastAccessTime)
+		timespec_to_file_time(&st.st_atim, lpLastAccessTime);
+	if(lpLastWriteTime)
+		timespec_to_file_time(&st.st_mtim, lpLastWriteTime);
+
+	return TRUE;
+}
+
+BOOL SetFileTime(HANDLE hFile, const FILETIME* lpCreationTime, const FILETIME* lpLastAccessTime, const FILETIME* lpLastWriteTime) {
+	posix_handle* h = hFile;
+
+	// The creation time can't be set, the times that aren't specified are left as they are
+	struct timespec times[2] = {{.tv_nsec = UTIME_OMIT}, {.tv_nsec = UTIME_OMIT}};
+	if(lpLastAccessTime)
+		file_time_to_timespec(lpLastAccessTime, times);
+	if(lpLastWriteTime)
+		file_time_to_timespec(lpLastWriteTime, times + 1);
+
+	return futimens(h->fd, times) == 0 ? TRUE : fail_with_errno();
+}
+
+void GetSystemTimeAsFileTime(LPFILETIME lpSystemTimeAsFileTime) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	timespec_to_file_time(&ts, lpSystemTimeAsFileTime);
+}
+
+BOOL FileTimeToSystemTime(const FILETIME* lpFileTime, LPSYSTEMTIME lpSystemTime) {
+	int64_t ticks = ((uint64_t) lpFileTime->dwHighDateTime << 32 | lpFileTime->dwLowDateTime) - FILETIME_UNIX_EPOCH_OFFSET;
+	int64_t seconds = ticks / FILETIME_TICKS_PER_SECOND, remainder = ticks % FILETIME_TICKS_PER_SECOND;
+	if(remainder < 0) {
+		seconds--;
+		remainder += FILETIME_TICKS_PER_SECOND;
+	}
+
+	time_t t = seconds;
+	struct tm tm;
+	if(gmtime_r(&t, &tm) == NULL)
+		return fail(ERROR_INVALID_PARAMETER);
+
+	tm_to_system_time(&tm, remainder / 10000, lpSystemTime);
+	return TRUE;
+}
+
+BOOL SystemTimeToTzSpecificLocalTime(const TIME_ZONE_INFORMATION* lpTimeZoneInformation, const SYSTEMTIME* lpUniversalTime, LPSYSTEMTIME lpLocalTime) {
+	// Only the currently active time zone is supported
+	if(lpTimeZoneInformation != NULL)
+		return fail(ERROR_NOT_SUPPORTED);
+
+	struct tm tm = {
+		.tm_year = lpUniversalTime->wYear - 1900,
+		.tm_mon = lpUniversalTime->wMonth - 1,
+		.tm_mday = lpUniversalTime->wDay,
+		.tm_hour = lpUniversalTime->wHour,
+		.tm_min = lpUniversalTime->wMinute,
+		.tm_sec = lpUniversalTime->wSecond
+	};
+
+	time_t t = timegm(&tm);
+	if(localtime_r(&t, &tm) == NULL)
+		return fail(ERROR_INVALID_PARAMETER);
+
+	tm_to_system_time(&tm, lpUniversalTime->wMilliseconds, lpLocalTime);
+	return TRUE;
+}
+
+
+HANDLE FindFirstFile(LPCTSTR lpFileName, LPWIN32_FIND_DATA lpFindFileData) {
+	size_t path_length = strlen(lpFileName);
+	char path[path_length + 1];
+	memcpy(path, lpFileName, path_length + 1);
+
+	// Only the "directory/*" pattern is supported
+	char* pattern = strrchr(path, '/');
+	if(strcmp(pattern ? pattern + 1 : path, "*")) {
+		fail(ERROR_NOT_SUPPORTED);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	if(pattern == path)
+		pattern[1] = '\0';
+	else if(pattern)
+		*pattern = '\0';
+
+	DIR* dir = opendir(pattern ? path : ".");
+	if(dir == NULL) {
+		fail_with_errno();
+		return INVALID_HANDLE_VALUE;
+	}
+
+	posix_handle* h = handle_create(FIND_HANDLE);
+	if(h == NULL) {
+		closedir(dir);
+		fail(ERROR_NOT_ENOUGH_MEMORY);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	h->dir = dir;
+
+	if(!read_directory_entry(dir, lpFindFileData)) {
+		DWORD error = last_error;
+		CloseHandle(h);
+		fail(error == ERROR_NO_MORE_FILES ? ERROR_FILE_NOT_FOUND : error);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	return h;
+}
+
+BOOL FindNextFile(HANDLE hFindFile, LPWIN32_FIND_DATA lpFindFileData) {
+	posix_handle* h = hFindFile;
+	return read_directory_entry(h->dir, lpFindFileData);
+}
+
+BOOL FindClose(HANDLE hFindFile) {
+	return CloseHandle(hFindFile);
+}
+
+
+BOOL GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize) {
+	posix_handle* h = hFile;
+	struct stat st;
+	if(fstat(h->fd, &st) == -1)
+		return fail_with_errno();
+
+	lpFileSize->QuadPart = st.st_size;
+	return TRUE;
+}
+
+
+HANDLE CreateThread(LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSize, LPTHREAD_START_ROUTINE lpStartAddress, LPVOID lpParameter, DWORD dwCreationFlags, LPDWORD lpThreadId) {
+	// Suspended creation is not supported
+	if(dwCreationFlags != 0) {
+		fail(ERROR_NOT_SUPPORTED);
+		return NULL;
+	}
+
+	posix_handle* h = handle_create(THREAD_HANDLE);
+	thread_start_data* tsd = malloc(sizeof(thread_start_data));
+	if(h == NULL || tsd == NULL) {
+		free(h);
+		free(tsd);
+		fail(ERROR_NOT_ENOUGH_MEMORY);
+		return NULL;
+	}
+
+	tsd->start_address = lpStartAddress;
+	tsd->parameter = lpParameter;
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	if(dwStackSize > 0)
+		pthread_attr_setstacksize(&attr, dwStackSize);
+
+	int err = pthread_create(&h->thread.id, &attr, thread_start, tsd);
+	pthread_attr_destroy(&attr);
+
+	if(err) {
+		free(h);
+		free(tsd);
+		fail(errno_to_error(err));
+		return NULL;
+	}
+
+	if(lpThreadId)
+		*lpThreadId = 0;
+
+	return h;
+}
+
+DWORD WaitForMultipleObjects(DWORD nCount, const HANDLE* lpHandles, BOOL bWaitAll, DWORD dwMilliseconds) {
+	// Only waiting indefinitely for every thread is supported
+	if(!bWaitAll || dwMilliseconds != INFINITE) {
+		fail(ERROR_NOT_SUPPORTED);
+		return WAIT_FAILED;
+	}
+
+	for(DWORD i = 0; i < nCount; i++) {
+		posix_handle* h = lpHandles[i];
+		if(h->type != THREAD_HANDLE) {
+			fail(ERROR_INVALID_HANDLE);
+			return WAIT_FAILED;
+		}
+
+		if(h->thread.joined)
+			continue;
+
+		int err = pthread_join(h->thread.id, NULL);
+		if(err) {
+			fail(errno_to_error(err));
+			return WAIT_FAILED;
+		}
+
+		h->thread.joined = true;
+	}
+
+	return WAIT_OBJECT_0;
+}
+
+
+HANDLE CreateEvent(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCTSTR lpName) {
+	// Overlapped operations complete synchronously, so events are never waited for and only need to exist
+	posix_handle* h = handle_create(EVENT_HANDLE);
+	if(h == NULL)
+		fail(ERROR_NOT_ENOUGH_MEMORY);
+	return h;
+}
+
+
+void InitializeCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+	pthread_mutex_init(lpCriticalSection, NULL);
+}
+
+void DeleteCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+	pthread_mutex_destroy(lpCriticalSection);
+}
+
+void EnterCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+	pthread_mutex_lock(lpCriticalSection);
+}
+
+void LeaveCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+	pthread_mutex_unlock(lpCriticalSection);
+}
+
+
+void InitializeConditionVariable(PCONDITION_VARIABLE ConditionVariable) {
+	pthread_cond_init(ConditionVariable, NULL);
+}
+
+BOOL SleepConditionVariableCS(PCONDITION_VARIABLE ConditionVariable, LPCRITICAL_SECTION CriticalSection, DWORD dwMilliseconds) {
+	// Only waiting indefinitely is supported
+	if(dwMilliseconds != INFINITE)
+		return fail(ERROR_NOT_SUPPORTED);
+
+	int err = pthread_cond_wait(ConditionVariable, CriticalSection);
+	return err == 0 ? TRUE : fail(errno_to_error(err));
+}
+
+void WakeConditionVariable(PCONDITION_VARIABLE ConditionVariable) {
+	pthread_cond_signal(ConditionVariable);
+}
+
+void WakeAllConditionVariable(PCONDITION_VARIABLE ConditionVariable) {
+	pthread_cond_broadcast(ConditionVariable);
+}
+
+
+static void run_init_once_function(void) {
+	init_once_call.result = init_once_call.function(init_once_call.init_once, init_once_call.parameter, init_once_call.context);
+}
+
+BOOL InitOnceExecuteOnce(PINIT_ONCE InitOnce, PINIT_ONCE_FN InitFn, LPVOID Parameter, LPVOID* Context) {
+	// Failed initializations aren't retried, unlike on Windows, so the function must succeed
+	init_once_call.init_once = InitOnce;
+	init_once_call.function = InitFn;
+	init_once_call.parameter = Parameter;
+	init_once_call.context = Context;
+	init_once_call.result = TRUE;
+
+	int err = pthread_once(InitOnce, run_init_once_function);
+	return err != 0 ? fail(errno_to_error(err)) : init_once_call.result;
+}
+
+
+void GetSystemInfo(LPSYSTEM_INFO lpSystemInfo) {
+	long num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+	lpSystemInfo->dwNumberOfProcessors = num_processors > 0 ? num_processors : 1;
+}
+
+ULONGLONG GetTickCount64(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ULONGLONG) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+#ifdef __linux__
+typedef enum {
+	CLONE_RANGE,
+	COPY_FILE_RANGE,
+	SEND_FILE
+} kernel_copy_method;
+
+static bool is_unsupported_copy_error(int err) {
+	return err == EINVAL || err == EXDEV || err == ENOSYS || err == EOPNOTSUPP || err == ENOTSUP || err == ETXTBSY;
+}
+
+BOOL CopyFileRange(HANDLE hSourceFile, uint64_t sourceOffset, HANDLE hTargetFile, uint64_t targetOffset, uint64_t numberOfBytes) {
+	posix_handle* source = hSourceFile;
+	posix_handle* target = hTargetFile;
+	uint64_t total_bytes_copied = 0;
+
+	// Try the cheapest method first: reflinks only exist between files and sendfile is the only one that writes to pipes
+	kernel_copy_method method = target->seekable ? CLONE_RANGE : SEND_FILE;
+
+	while(total_bytes_copied < numberOfBytes) {
+		off_t source_offset = sourceOffset + total_bytes_copied;
+		off_t target_offset = targetOffset + total_bytes_copied;
+		size_t count = numberOfBytes - total_bytes_copied < MAX_KERNEL_COPY_SIZE ? numberOfBytes - total_bytes_copied : MAX_KERNEL_COPY_SIZE;
+		ssize_t bytes_copied;
+
+		switch(method) {
+			case(CLONE_RANGE): {
+				// Only shares whole blocks, so it usually fails unless both offsets are block aligned
+				struct file_clone_range fcr = {source->fd, source_offset, numberOfBytes - total_bytes_copied, target_offset};
+				bytes_copied = ioctl(target->fd, FICLONERANGE, &fcr) == 0 ? (ssize_t)(numberOfBytes - total_bytes_copied) : -1;
+				break;
+			}
+			case(COPY_FILE_RANGE):
+				bytes_copied = copy_file_range(source->fd, &source_offset, target->fd, &target_offset, count, 0);
+				break;
+			case(SEND_FILE):
+				// sendfile writes at the target's file pointer
+				if(target->seekable && lseek(target->fd, target_offset, SEEK_SET) == -1)
+					return fail_with_errno();
+				bytes_copied = sendfile(target->fd, source->fd, &source_offset, count);
+				break;
+		}
+
+		if(bytes_copied == -1) {
+			if(errno == EINTR)
+				continue;
+
+			// Fall back to the next method, unless part of the data was already copied by the last one
+			if(is_unsupported_copy_error(errno) && (method != SEND_FILE || total_bytes_copied == 0)) {
+				if(method == SEND_FILE)
+					return fail(ERROR_NOT_SUPPORTED);
+				method++;
+				continue;
+			}
+
+			return fail_with_errno();
+		}
+
+		// End of the source file
+		if(bytes_copied == 0)
+			return fail(ERROR_HANDLE_EOF);
+
+		total_bytes_copied += bytes_copied;
+	}
+
+	return TRUE;
+}
+
+BOOL CollapseFileRange(HANDLE hFile, uint64_t offset, uint64_t numberOfBytes) {
+	posix_handle* h = hFile;
+
+	if(fallocate(h->fd, FALLOC_FL_COLLAPSE_RANGE, offset, numberOfBytes) == 0)
+		return TRUE;
+
+	return errno == EOPNOTSUPP || errno == ENOSYS ? fail(ERROR_NOT_SUPPORTED) : fail_with_errno();
+}
+
+DWORD GetFileBlockSize(HANDLE hFile) {
+	posix_handle* h = hFile;
+	struct stat st;
+
+	if(fstat(h->fd, &st) == -1) {
+		fail_with_errno();
+		return 0;
+	}
+
+	return st.st_blksize;
+}
+#endif
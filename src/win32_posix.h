@@ -0,0 +1,281 @@
+#ifndef _WIN32_POSIX_H
+#define _WIN32_POSIX_H
+
+/*
+ * POSIX implementation of the subset of the Win32 API used by the wrapper functions.
+ *
+ * Files are backed by file descriptors and always accessed with pread/pwrite when an
+ * OVERLAPPED offset is given, threads by pthreads and paths are native UTF-8 strings.
+ * Only the behaviour the project relies on is implemented.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <pthread.h>
+
+/* Types */
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned long DWORD; 	// same as Win32 so "%lu" format strings stay portable
+typedef unsigned int UINT;
+typedef long LONG;
+typedef unsigned long ULONG;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+
+typedef void* HANDLE;
+typedef void* HWND;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef DWORD* LPDWORD;
+typedef BOOL* LPBOOL;
+
+typedef char TCHAR;
+typedef char* LPTSTR;
+typedef const char* LPCTSTR;
+
+typedef union {
+	struct {
+		DWORD LowPart;
+		LONG HighPart;
+	};
+	LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef struct {
+	DWORD nLength;
+	LPVOID lpSecurityDescriptor;
+	BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+typedef struct {
+	ULONG_PTR Internal;
+	ULONG_PTR InternalHigh; 	// number of bytes transferred
+	DWORD Offset;
+	DWORD OffsetHigh;
+	HANDLE hEvent;
+} OVERLAPPED, *LPOVERLAPPED;
+
+typedef struct {
+	DWORD dwLowDateTime;
+	DWORD dwHighDateTime;
+} FILETIME, *LPFILETIME;
+
+typedef struct {
+	WORD wYear;
+	WORD wMonth;
+	WORD wDayOfWeek;
+	WORD wDay;
+	WORD wHour;
+	WORD wMinute;
+	WORD wSecond;
+	WORD wMilliseconds;
+} SYSTEMTIME, *LPSYSTEMTIME;
+
+typedef struct TIME_ZONE_INFORMATION TIME_ZONE_INFORMATION;
+
+#define MAX_PATH PATH_MAX
+
+typedef struct {
+	DWORD dwFileAttributes;
+	FILETIME ftLastWriteTime;
+	DWORD nFileSizeHigh;
+	DWORD nFileSizeLow;
+	TCHAR cFileName[MAX_PATH];
+} WIN32_FIND_DATA, *LPWIN32_FIND_DATA;
+
+typedef struct {
+	DWORD dwNumberOfProcessors;
+} SYSTEM_INFO, *LPSYSTEM_INFO;
+
+typedef pthread_mutex_t CRITICAL_SECTION, *LPCRITICAL_SECTION;
+typedef pthread_cond_t CONDITION_VARIABLE, *PCONDITION_VARIABLE;
+typedef pthread_once_t INIT_ONCE, *PINIT_ONCE;
+
+#define WINAPI
+#define __drv_aliasesMem
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID lpThreadParameter);
+typedef BOOL (WINAPI *PINIT_ONCE_FN)(PINIT_ONCE InitOnce, LPVOID Parameter, LPVOID* Context);
+
+
+/* Constants */
+
+#define TRUE 								1
+#define FALSE 								0
+
+#define INVALID_HANDLE_VALUE 				((HANDLE)(intptr_t) -1)
+#define INVALID_FILE_ATTRIBUTES 			((DWORD) -1)
+
+#define GENERIC_READ 						0x80000000
+#define GENERIC_WRITE 						0x40000000
+#define FILE_WRITE_ATTRIBUTES 				0x00000100 	// granted with any access, file times are set by the file's owner
+
+#define FILE_SHARE_READ 					0x00000001
+#define FILE_SHARE_WRITE 					0x00000002
+
+#define CREATE_NEW 							1
+#define CREATE_ALWAYS 						2
+#define OPEN_EXISTING 						3
+#define OPEN_ALWAYS 						4
+#define TRUNCATE_EXISTING 					5
+
+#define FILE_ATTRIBUTE_READONLY 			0x00000001
+#define FILE_ATTRIBUTE_HIDDEN 				0x00000002
+#define FILE_ATTRIBUTE_SYSTEM 				0x00000004
+#define FILE_ATTRIBUTE_DIRECTORY 			0x00000010
+#define FILE_ATTRIBUTE_ARCHIVE 				0x00000020
+#define FILE_ATTRIBUTE_NORMAL 				0x00000080
+
+#define FILE_FLAG_SEQUENTIAL_SCAN 			0x08000000
+#define FILE_FLAG_RANDOM_ACCESS 			0x10000000
+#define FILE_FLAG_OVERLAPPED 				0x40000000
+
+#define STD_INPUT_HANDLE 					((DWORD) -10)
+#define STD_OUTPUT_HANDLE 					((DWORD) -11)
+#define STD_ERROR_HANDLE 					((DWORD) -12)
+
+#define FILE_TYPE_UNKNOWN 					0x0000
+#define FILE_TYPE_DISK 						0x0001
+#define FILE_TYPE_CHAR 						0x0002
+#define FILE_TYPE_PIPE 						0x0003
+
+#define FILE_BEGIN 							0
+#define FILE_CURRENT 						1
+#define FILE_END 							2
+
+#define MOVEFILE_REPLACE_EXISTING 			0x0001
+
+#define INFINITE 							0xFFFFFFFF
+#define WAIT_OBJECT_0 						0x00000000
+#define WAIT_FAILED 						0xFFFFFFFF
+
+#define INIT_ONCE_STATIC_INIT 				PTHREAD_ONCE_INIT
+
+#define ERROR_SUCCESS 						0
+#define ERROR_FILE_NOT_FOUND 				2
+#define ERROR_PATH_NOT_FOUND 				3
+#define ERROR_TOO_MANY_OPEN_FILES 			4
+#define ERROR_ACCESS_DENIED 				5
+#define ERROR_INVALID_HANDLE 				6
+#define ERROR_NOT_ENOUGH_MEMORY 			8
+#define ERROR_NO_MORE_FILES 				18
+#define ERROR_HANDLE_EOF 					38
+#define ERROR_NOT_SUPPORTED 				50
+#define ERROR_FILE_EXISTS 					80
+#define ERROR_INVALID_PARAMETER 			87
+#define ERROR_DISK_FULL 					112
+#define ERROR_ALREADY_EXISTS 				183
+#define ERROR_IO_PENDING 					997
+
+
+/* Generic-text mappings */
+
+#define TEXT(s) 	s
+#define _tmain 		main
+#define _tcslen 	strlen
+#define _tcscpy 	strcpy
+#define _tcscmp 	strcmp
+#define _tcsncmp 	strncmp
+#define _tcsicmp 	strcasecmp
+#define _tcsrchr 	strrchr
+#define _tcstol 	strtol
+#define _sntprintf 	snprintf
+
+
+/* Functions */
+
+DWORD GetLastError(void);
+
+HANDLE CreateFile(LPCTSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile);
+BOOL CloseHandle(HANDLE hObject);
+
+HANDLE GetStdHandle(DWORD nStdHandle);
+DWORD GetFileType(HANDLE hFile);
+
+BOOL CreateDirectory(LPCTSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes);
+BOOL DeleteFile(LPCTSTR lpFileName);
+BOOL MoveFileEx(LPCTSTR lpExistingFileName, LPCTSTR lpNewFileName, DWORD dwFlags);
+int SHCreateDirectoryEx(HWND hwnd, LPCTSTR pszPath, const SECURITY_ATTRIBUTES *psa);
+DWORD GetFullPathName(LPCTSTR lpFileName, DWORD nBufferLength, LPTSTR lpBuffer, LPTSTR *lpFilePart);
+
+BOOL ReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped);
+BOOL WriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, LPDWORD lpNumberOfBytesWritten, LPOVERLAPPED lpOverlapped);
+
+BOOL SetFilePointerEx(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer, DWORD dwMoveMethod);
+BOOL SetEndOfFile(HANDLE hFile);
+BOOL FlushFileBuffers(HANDLE hFile);
+
+BOOL GetOverlappedResult(HANDLE hFile, LPOVERLAPPED lpOverlapped, LPDWORD lpNumberOfBytesTransferred, BOOL bWait);
+
+DWORD GetFileAttributes(LPCTSTR lpFileName);
+BOOL SetFileAttributes(LPCTSTR lpFileName, DWORD dwFileAttributes);
+
+BOOL GetFileTime(HANDLE hFile, LPFILETIME lpCreationTime, LPFILETIME lpLastAccessTime, LPFILETIME lpLastWriteTime);
+BOOL SetFileTime(HANDLE hFile, const FILETIME* lpCreationTime, const FILETIME* lpLastAccessTime, const FILETIME* lpLastWriteTime);
+void GetSystemTimeAsFileTime(LPFILETIME lpSystemTimeAsFileTime);
+BOOL FileTimeToSystemTime(const FILETIME* lpFileTime, LPSYSTEMTIME lpSystemTime);
+BOOL SystemTimeToTzSpecificLocalTime(const TIME_ZONE_INFORMATION* lpTimeZoneInformation, const SYSTEMTIME* lpUniversalTime, LPSYSTEMTIME lpLocalTime);
+
+HANDLE FindFirstFile(LPCTSTR lpFileName, LPWIN32_FIND_DATA lpFindFileData);
+BOOL FindNextFile(HANDLE hFindFile, LPWIN32_FIND_DATA lpFindFileData);
+BOOL FindClose(HANDLE hFindFile);
+
+BOOL GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize);
+
+HANDLE CreateThread(LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSize, LPTHREAD_START_ROUTINE lpStartAddress, LPVOID lpParameter, DWORD dwCreationFlags, LPDWORD lpThreadId);
+DWORD WaitForMultipleObjects(DWORD nCount, const HANDLE* lpHandles, BOOL bWaitAll, DWORD dwMilliseconds);
+
+HANDLE CreateEvent(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCTSTR lpName);
+
+void InitializeCriticalSection(LPCRITICAL_SECTION lpCriticalSection);
+void DeleteCriticalSection(LPCRITICAL_SECTION lpCriticalSection);
+void EnterCriticalSection(LPCRITICAL_SECTION lpCriticalSection);
+void LeaveCriticalSection(LPCRITICAL_SECTION lpCriticalSection);
+
+void InitializeConditionVariable(PCONDITION_VARIABLE ConditionVariable);
+BOOL SleepConditionVariableCS(PCONDITION_VARIABLE ConditionVariable, LPCRITICAL_SECTION CriticalSection, DWORD dwMilliseconds);
+void WakeConditionVariable(PCONDITION_VARIABLE ConditionVariable);
+void WakeAllConditionVariable(PCONDITION_VARIABLE ConditionVariable);
+
+BOOL InitOnceExecuteOnce(PINIT_ONCE InitOnce, PINIT_ONCE_FN InitFn, LPVOID Parameter, LPVOID* Context);
+
+void GetSystemInfo(LPSYSTEM_INFO lpSystemInfo);
+ULONGLONG GetTickCount64(void);
+
+
+/* Extensions */
+
+#ifdef __linux__
+#define COPY_FILE_RANGE_SUPPORTED
+
+/*
+ * Copies data between two files without it passing through the process, sharing the file system blocks
+ * where possible. The target offset is ignored for pipes. Fails with ERROR_NOT_SUPPORTED, having copied
+ * nothing, if the kernel can't copy between the files.
+ */
+BOOL CopyFileRange(HANDLE hSourceFile, uint64_t sourceOffset, HANDLE hTargetFile, uint64_t targetOffset, uint64_t numberOfBytes);
+
+#define COLLAPSE_RANGE_SUPPORTED
+
+/*
+ * Removes a range of a file, moving the data after it down by just remapping the file system blocks.
+ * The offset and length must be multiples of the file's block size and the range must end before the
+ * end of the file. Fails with ERROR_NOT_SUPPORTED, having removed nothing, if the file system can't do it.
+ */
+BOOL CollapseFileRange(HANDLE hFile, uint64_t offset, uint64_t numberOfBytes);
+
+/*
+ * Returns the block size of the file's file system, which file ranges are collapsed in multiples of.
+ */
+DWORD GetFileBlockSize(HANDLE hFile);
+#endif
+
+#endif
@@ -1,8 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
-#include <windows.h>
+#include "platform.h"
+#ifdef _WIN32
 #include <shlobj.h>
+#endif
 #include "wrapper_functions.h"
 
 void exit_with_error(const char* format, ...) {
@@ -45,10 +47,10 @@ void Free(void* ptr) {
 }
 
 
-HANDLE _CreateFileW(LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile) {
-    HANDLE hFile = CreateFileW(lpFileName, dwDesiredAccess, dwShareMode, lpSecurityAttributes, dwCreationDisposition, dwFlagsAndAttributes, hTemplateFile);
+HANDLE _CreateFile(LPCTSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile) {
+    HANDLE hFile = CreateFile(lpFileName, dwDesiredAccess, dwShareMode, lpSecurityAttributes, dwCreationDisposition, dwFlagsAndAttributes, hTemplateFile);
     if(hFile == INVALID_HANDLE_VALUE)
-        exit_with_error("CreateFileW error: %lu\n", GetLastError());
+        exit_with_error("CreateFile error: %lu\n", GetLastError());
     return hFile;
 }
 
@@ -58,20 +60,20 @@ void _CloseHandle(HANDLE hObject) {
 }
 
 
-void _CreateDirectoryW(LPCWSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes) {
-    if(!CreateDirectoryW(lpPathName, lpSecurityAttributes))
-        exit_with_error("CreateDirectoryW error: %lu\n", GetLastError());
+void _CreateDirectory(LPCTSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes) {
+    if(!CreateDirectory(lpPathName, lpSecurityAttributes))
+        exit_with_error("CreateDirectory error: %lu\n", GetLastError());
 }
 
-void _SHCreateDirectoryExW(HWND hwnd, LPCWSTR pszPath, const SECURITY_ATTRIBUTES *psa) {
-    if(SHCreateDirectoryExW(hwnd, pszPath, psa) != ERROR_SUCCESS)
-        exit_with_error("SHCreateDirectoryExA error: %lu\n", GetLastError());
+void _SHCreateDirectoryEx(HWND hwnd, LPCTSTR pszPath, const SECURITY_ATTRIBUTES *psa) {
+    if(SHCreateDirectoryEx(hwnd, pszPath, psa) != ERROR_SUCCESS)
+        exit_with_error("SHCreateDirectoryEx error: %lu\n", GetLastError());
 }
 
-DWORD _GetFullPathNameW(LPCWSTR lpFileName, DWORD nBufferLength, LPWSTR lpBuffer, LPWSTR *lpFilePart) {
-    DWORD dwRetVal = GetFullPathNameW(lpFileName, nBufferLength, lpBuffer, lpFilePart);
+DWORD _GetFullPathName(LPCTSTR lpFileName, DWORD nBufferLength, LPTSTR lpBuffer, LPTSTR *lpFilePart) {
+    DWORD dwRetVal = GetFullPathName(lpFileName, nBufferLength, lpBuffer, lpFilePart);
     if(dwRetVal == 0)
-        exit_with_error("GetFullPathNameW error: %lu\n", GetLastError());
+        exit_with_error("GetFullPathName error: %lu\n", GetLastError());
     return dwRetVal;
 }
 
@@ -106,26 +108,102 @@ LONGLONG _GetFilePointerEx(HANDLE hFile) {
 
 
 void _Rewind(HANDLE hFile) {
-    if(SetFilePointer(hFile, 0, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
+    if(!SetFilePointerEx(hFile, (LARGE_INTEGER){.QuadPart = 0}, NULL, FILE_BEGIN))
         exit_with_error("Rewind error: %lu\n", GetLastError());
 }
 
+void _SetEndOfFile(HANDLE hFile) {
+    if(!SetEndOfFile(hFile))
+        exit_with_error("SetEndOfFile error: %lu\n", GetLastError());
+}
+
+void _FlushFileBuffers(HANDLE hFile) {
+    if(!FlushFileBuffers(hFile))
+        exit_with_error("FlushFileBuffers error: %lu\n", GetLastError());
+}
+
+HANDLE _GetStdHandle(DWORD nStdHandle) {
+    HANDLE hStd = GetStdHandle(nStdHandle);
+    if(hStd == INVALID_HANDLE_VALUE || hStd == NULL)
+        exit_with_error("GetStdHandle error: %lu\n", GetLastError());
+    return hStd;
+}
+
+DWORD _GetFileType(HANDLE hFile) {
+    DWORD type = GetFileType(hFile);
+    if(type == FILE_TYPE_UNKNOWN && GetLastError() != ERROR_SUCCESS)
+        exit_with_error("GetFileType error: %lu\n", GetLastError());
+    return type;
+}
+
+DWORD _ReadFileAt(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, uint64_t offset) {
+    OVERLAPPED overlapped = {0};
+    overlapped.Offset = offset & 0xFFFFFFFF;
+    overlapped.OffsetHigh = offset >> 32;
+
+    DWORD dwBytesRead;
+    _ReadFile(hFile, lpBuffer, nNumberOfBytesToRead, NULL, &overlapped);
+    _GetOverlappedResult(hFile, &overlapped, &dwBytesRead, TRUE);
+    return dwBytesRead;
+}
+
+void _WriteFileAt(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, uint64_t offset) {
+    OVERLAPPED overlapped = {0};
+    overlapped.Offset = offset & 0xFFFFFFFF;
+    overlapped.OffsetHigh = offset >> 32;
+
+    DWORD dwBytesWritten;
+    _WriteFile(hFile, lpBuffer, nNumberOfBytesToWrite, NULL, &overlapped);
+    _GetOverlappedResult(hFile, &overlapped, &dwBytesWritten, TRUE);
+}
+
+#ifdef COPY_FILE_RANGE_SUPPORTED
+BOOL _CopyFileRange(HANDLE hSourceFile, uint64_t sourceOffset, HANDLE hTargetFile, uint64_t targetOffset, uint64_t numberOfBytes) {
+    // Returns FALSE if the files need to be copied by hand instead
+    if(!CopyFileRange(hSourceFile, sourceOffset, hTargetFile, targetOffset, numberOfBytes)) {
+        if(GetLastError() == ERROR_NOT_SUPPORTED)
+            return FALSE;
+        exit_with_error("CopyFileRange error: %lu\n", GetLastError());
+    }
+    return TRUE;
+}
+#endif
+
+#ifdef COLLAPSE_RANGE_SUPPORTED
+BOOL _CollapseFileRange(HANDLE hFile, uint64_t offset, uint64_t numberOfBytes) {
+    // Returns FALSE if the data needs to be moved by hand instead
+    if(!CollapseFileRange(hFile, offset, numberOfBytes)) {
+        if(GetLastError() == ERROR_NOT_SUPPORTED)
+            return FALSE;
+        exit_with_error("CollapseFileRange error: %lu\n", GetLastError());
+    }
+    return TRUE;
+}
+
+DWORD _GetFileBlockSize(HANDLE hFile) {
+    DWORD dwBlockSize = GetFileBlockSize(hFile);
+    if(dwBlockSize == 0)
+        exit_with_error("GetFileBlockSize error: %lu\n", GetLastError());
+    return dwBlockSize;
+}
+#endif
+
 void _GetOverlappedResult(HANDLE hFile, LPOVERLAPPED lpOverlapped, LPDWORD lpNumberOfBytesTransferred, BOOL bWait) {
     if(!GetOverlappedResult(hFile, lpOverlapped, lpNumberOfBytesTransferred, bWait))
         exit_with_error("GetOverlappedResult error: %lu\n", GetLastError());
 }
 
 
-DWORD _GetFileAttributesW(LPCWSTR lpFileName) {
-    DWORD dwAttributes = GetFileAttributesW(lpFileName);
+DWORD _GetFileAttributes(LPCTSTR lpFileName) {
+    DWORD dwAttributes = GetFileAttributes(lpFileName);
     if(dwAttributes == INVALID_FILE_ATTRIBUTES)
-        exit_with_error("GetFileAttributesW error: %lu\n", GetLastError());
+        exit_with_error("GetFileAttributes error: %lu\n", GetLastError());
     return dwAttributes;
 }
 
-void _SetFileAttributesW(LPCWSTR lpFileName, DWORD dwFileAttributes) {
-    if(!SetFileAttributesW(lpFileName, dwFileAttributes))
-        exit_with_error("SetFileAttributesW error: %lu\n", GetLastError());
+void _SetFileAttributes(LPCTSTR lpFileName, DWORD dwFileAttributes) {
+    if(!SetFileAttributes(lpFileName, dwFileAttributes))
+        exit_with_error("SetFileAttributes error: %lu\n", GetLastError());
 }
 
 
@@ -145,17 +223,17 @@ void _SystemTimeToTzSpecificLocalTime(const TIME_ZONE_INFORMATION* lpTimeZoneInf
 }
 
 
-HANDLE _FindFirstFileW(LPCWSTR lpFileName, LPWIN32_FIND_DATAW lpFindFileData) {
-    HANDLE hFindFile = FindFirstFileW(lpFileName, lpFindFileData);
+HANDLE _FindFirstFile(LPCTSTR lpFileName, LPWIN32_FIND_DATA lpFindFileData) {
+    HANDLE hFindFile = FindFirstFile(lpFileName, lpFindFileData);
     if(hFindFile == INVALID_HANDLE_VALUE)
-        exit_with_error("FindFirstFileW error: %lu\n", GetLastError());
+        exit_with_error("FindFirstFile error: %lu\n", GetLastError());
     return hFindFile;
 }
 
-BOOL _FindNextFileW(HANDLE hFindFile, LPWIN32_FIND_DATAW lpFindFileData) {
-    if(!FindNextFileW(hFindFile, lpFindFileData)) {
+BOOL _FindNextFile(HANDLE hFindFile, LPWIN32_FIND_DATA lpFindFileData) {
+    if(!FindNextFile(hFindFile, lpFindFileData)) {
         if(GetLastError() != ERROR_NO_MORE_FILES)
-            exit_with_error("FindNextFileW error: %lu\n", GetLastError());
+            exit_with_error("FindNextFile error: %lu\n", GetLastError());
         return FALSE;
     }
     return TRUE;
@@ -180,6 +258,16 @@ HANDLE _CreateThread(LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSiz
     return hThread;
 }
 
+void _SleepConditionVariableCS(PCONDITION_VARIABLE ConditionVariable, LPCRITICAL_SECTION CriticalSection, DWORD dwMilliseconds) {
+    if(!SleepConditionVariableCS(ConditionVariable, CriticalSection, dwMilliseconds))
+        exit_with_error("SleepConditionVariableCS error: %lu\n", GetLastError());
+}
+
+void _InitOnceExecuteOnce(PINIT_ONCE InitOnce, PINIT_ONCE_FN InitFn, LPVOID Parameter, LPVOID* Context) {
+    if(!InitOnceExecuteOnce(InitOnce, InitFn, Parameter, Context))
+        exit_with_error("InitOnceExecuteOnce error: %lu\n", GetLastError());
+}
+
 DWORD _WaitForMultipleObjects(DWORD nCount,const HANDLE* lpHandles,BOOL bWaitAll,DWORD dwMilliseconds) {
     DWORD dwWaitResult = WaitForMultipleObjects(nCount, lpHandles, bWaitAll, dwMilliseconds);
     if(dwWaitResult == WAIT_FAILED)
@@ -187,14 +275,14 @@ DWORD _WaitForMultipleObjects(DWORD nCount,const HANDLE* lpHandles,BOOL bWaitAll
     return dwWaitResult;
 }
 
-LPWSTR* _CommandLineToArgvW(LPCWSTR lpCmdLine, int *pNumArgs) {
-    LPWSTR* argv = CommandLineToArgvW(lpCmdLine, pNumArgs);
-    if(argv == NULL)
-        exit_with_error("CommandLineToArgvW error: %lu\n", GetLastError());
-    return argv;
+HANDLE _CreateEvent(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCTSTR lpName) {
+    HANDLE hEvent = CreateEvent(lpEventAttributes, bManualReset, bInitialState, lpName);
+    if(hEvent == NULL)
+        exit_with_error("CreateEvent error: %lu\n", GetLastError());
+    return hEvent;
 }
 
-
+#ifdef _WIN32
 int _WideCharToMultiByte(UINT CodePage, DWORD dwFlags, LPCWCH lpWideCharStr, int cchWideChar, LPSTR lpMultiByteStr, int cbMultiByte, LPCCH lpDefaultChar, LPBOOL lpUsedDefaultChar) {
     int ret = WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, lpMultiByteStr, cbMultiByte, lpDefaultChar, lpUsedDefaultChar);
     if(ret == 0)
@@ -208,3 +296,4 @@ int _MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCCH lpMultiByteStr, int
         exit_with_error("MultiByteToWideChar error: %lu\n", GetLastError());
     return ret;
 }
+#endif
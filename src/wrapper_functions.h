@@ -2,7 +2,8 @@
 #define _WRAPPER_FUNCTIONS_H
 
 #include <stdlib.h>
-#include <windows.h>
+#include <stdint.h>
+#include "platform.h"
 
 void exit_with_error(const char* format, ...);
 
@@ -13,12 +14,12 @@ void* Realloc(void* ptr, size_t size);
 void Free(void* ptr);
 
 
-HANDLE _CreateFileW(LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile);
+HANDLE _CreateFile(LPCTSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile);
 void _CloseHandle(HANDLE hObject);
 
-void _CreateDirectoryW(LPCWSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes);
-void _SHCreateDirectoryExW(HWND hwnd, LPCWSTR pszPath, const SECURITY_ATTRIBUTES *psa);
-DWORD _GetFullPathNameW(LPCWSTR lpFileName, DWORD nBufferLength, LPWSTR lpBuffer, LPWSTR *lpFilePart);
+void _CreateDirectory(LPCTSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes);
+void _SHCreateDirectoryEx(HWND hwnd, LPCTSTR pszPath, const SECURITY_ATTRIBUTES *psa);
+DWORD _GetFullPathName(LPCTSTR lpFileName, DWORD nBufferLength, LPTSTR lpBuffer, LPTSTR *lpFilePart);
 
 BOOL _ReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped);
 void _WriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, LPDWORD lpNumberOfBytesWritten, LPOVERLAPPED lpOverlapped);
@@ -26,28 +27,50 @@ void _WriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, LPD
 void _SetFilePointerEx(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer, DWORD dwMoveMethod);
 LONGLONG _GetFilePointerEx(HANDLE hFile);
 void _Rewind(HANDLE hFile);
+void _SetEndOfFile(HANDLE hFile);
+void _FlushFileBuffers(HANDLE hFile);
+
+HANDLE _GetStdHandle(DWORD nStdHandle);
+DWORD _GetFileType(HANDLE hFile);
+
+DWORD _ReadFileAt(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, uint64_t offset);
+void _WriteFileAt(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, uint64_t offset);
+
+#ifdef COPY_FILE_RANGE_SUPPORTED
+BOOL _CopyFileRange(HANDLE hSourceFile, uint64_t sourceOffset, HANDLE hTargetFile, uint64_t targetOffset, uint64_t numberOfBytes);
+#endif
+
+#ifdef COLLAPSE_RANGE_SUPPORTED
+BOOL _CollapseFileRange(HANDLE hFile, uint64_t offset, uint64_t numberOfBytes);
+DWORD _GetFileBlockSize(HANDLE hFile);
+#endif
 
 void _GetOverlappedResult(HANDLE hFile, LPOVERLAPPED lpOverlapped, LPDWORD lpNumberOfBytesTransferred, BOOL bWait);
 
-DWORD _GetFileAttributesW(LPCWSTR lpFileName);
-void _SetFileAttributesW(LPCWSTR lpFileName, DWORD dwFileAttributes);
+DWORD _GetFileAttributes(LPCTSTR lpFileName);
+void _SetFileAttributes(LPCTSTR lpFileName, DWORD dwFileAttributes);
 
 void _GetFileTime(HANDLE hFile, LPFILETIME lpCreationTime, LPFILETIME lpLastAccessTime, LPFILETIME lpLastWriteTime);
 void _FileTimeToSystemTime(const FILETIME* lpFileTime, LPSYSTEMTIME lpSystemTime);
 void _SystemTimeToTzSpecificLocalTime(const TIME_ZONE_INFORMATION* lpTimeZoneInformation, const SYSTEMTIME* lpUniversalTime, LPSYSTEMTIME lpLocalTime);
 
-HANDLE _FindFirstFileW(LPCWSTR lpFileName, LPWIN32_FIND_DATAW lpFindFileData);
-BOOL _FindNextFileW(HANDLE hFindFile, LPWIN32_FIND_DATAW lpFindFileData);
+HANDLE _FindFirstFile(LPCTSTR lpFileName, LPWIN32_FIND_DATA lpFindFileData);
+BOOL _FindNextFile(HANDLE hFindFile, LPWIN32_FIND_DATA lpFindFileData);
 void _FindClose(HANDLE hFindFile);
 
 void _GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize);
 
 HANDLE _CreateThread(LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSize, LPTHREAD_START_ROUTINE  lpStartAddress, __drv_aliasesMem LPVOID lpParameter, DWORD dwCreationFlags, LPDWORD lpThreadId);
+void _SleepConditionVariableCS(PCONDITION_VARIABLE ConditionVariable, LPCRITICAL_SECTION CriticalSection, DWORD dwMilliseconds);
+void _InitOnceExecuteOnce(PINIT_ONCE InitOnce, PINIT_ONCE_FN InitFn, LPVOID Parameter, LPVOID* Context);
+
 DWORD _WaitForMultipleObjects(DWORD nCount,const HANDLE* lpHandles,BOOL bWaitAll,DWORD dwMilliseconds);
 
-LPWSTR* _CommandLineToArgvW(LPCWSTR lpCmdLine, int *pNumArgs);
+HANDLE _CreateEvent(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCTSTR lpName);
 
+#ifdef _WIN32
 int _WideCharToMultiByte(UINT CodePage, DWORD dwFlags, LPCWCH lpWideCharStr, int cchWideChar, LPSTR lpMultiByteStr, int cbMultiByte, LPCCH lpDefaultChar, LPBOOL lpUsedDefaultChar);
 int _MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCCH lpMultiByteStr, int cbMultiByte, LPWSTR lpWideCharStr, int cchWideChar);
+#endif
 
 #endif
\ No newline at end of file
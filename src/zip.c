@@ -1,53 +1,171 @@
+#include <string.h>
 #include "zip.h"
 #include "utils.h"
 #include "wrapper_functions.h"
 
-#define SEARCH_BUFFER_SIZE 										1024
-#define MAX_COMMENT_SIZE 										0xFFFF
-#define MAX_SEARCH_ITERATIONS 									(MAX_COMMENT_SIZE / SEARCH_BUFFER_SIZE)
+#define MAX_COMMENT_SIZE 	0xFFFF
+#define MAX_TAIL_SIZE 		(sizeof(zip64_end_of_central_directory_locator) + sizeof(end_of_central_directory_record) + MAX_COMMENT_SIZE)
 
-#define END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE_FIRST_BYTE 	(END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE & 0xFF)
+#define SIGNATURE_FIRST_BYTE 	0x50 	// 'P', which every signature starts with
+#define REPEATED_BYTES(b) 		(0x0101010101010101ULL * (b))
 
 
-void find_end_of_central_directory_record(LPWSTR zip_name, end_of_central_directory_record* out_eocdr) {
-	// Check if zip is empty
-	HANDLE hZip = _CreateFileW(zip_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-	_ReadFile(hZip, out_eocdr, sizeof(end_of_central_directory_record), NULL, NULL);
-	if(out_eocdr->signature == END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE)
+/* Helper Functions */
+
+/**
+ * Returns the offset of the last occurrence of the specified signature that starts at or before the specified offset
+ * in the data, or -1 if there is none. Eight bytes are checked at a time for the signature's first byte.
+*/
+static int64_t find_last_signature(const uint8_t* data, int64_t last_offset, uint32_t signature) {
+	int64_t offset = last_offset;
+
+	while(offset >= 0) {
+		// Skip whole words without the first byte, the bit trick flags the bytes of the word that are equal to it
+		if(offset >= 7) {
+			uint64_t word;
+			memcpy(&word, data + offset - 7, sizeof(uint64_t));
+			uint64_t x = word ^ REPEATED_BYTES(SIGNATURE_FIRST_BYTE);
+
+			if(((x - REPEATED_BYTES(0x01)) & ~x & REPEATED_BYTES(0x80)) == 0) {
+				offset -= 8;
+				continue;
+			}
+		}
+
+		uint32_t candidate;
+		memcpy(&candidate, data + offset, sizeof(uint32_t));
+		if(candidate == signature)
+			return offset;
+
+		offset--;
+	}
+
+	return -1;
+}
+
+/**
+ * Returns whether the end of central directory record at the specified offset in the zip fits
+ * the rest of the zip, since its signature may just be part of a comment.
+*/
+static bool is_valid_end_of_central_directory_record(const end_of_central_directory_record* eocdr, uint64_t eocdr_offset, uint64_t zip_size) {
+	if(eocdr_offset + sizeof(end_of_central_directory_record) + eocdr->comment_length > zip_size)
+		return false;
+	if(eocdr->disk_number != eocdr->central_directory_start_disk_number || eocdr->num_records_on_disk != eocdr->total_num_records)
+		return false;
+
+	// The central directory comes before the record, unless its values are only found in the zip64 record
+	return eocdr->central_directory_start_offset == 0xFFFFFFFF || eocdr->central_directory_size == 0xFFFFFFFF
+		|| (uint64_t) eocdr->central_directory_start_offset + eocdr->central_directory_size <= eocdr_offset;
+}
+
+/**
+ * Replaces the central directory's location with the one in the zip64 end of central directory record,
+ * if it's valid.
+*/
+static void read_zip64_end_of_central_directory_record(HANDLE hZip, const zip64_end_of_central_directory_locator* z64eocdl,
+			uint64_t locator_offset, central_directory_location* out_cdl) {
+	uint64_t z64eocdr_offset = z64eocdl->zip64_end_of_central_directory_record_offset;
+	if(z64eocdr_offset + sizeof(zip64_end_of_central_directory_record) > locator_offset)
 		return;
 
-	// Set file pointer to the start of the end of central directory record assuming there is no comment
-	LARGE_INTEGER li = {.QuadPart = -sizeof(end_of_central_directory_record)};
-	_SetFilePointerEx(hZip, li, &li, FILE_END);
-	_ReadFile(hZip, out_eocdr, sizeof(end_of_central_directory_record), NULL, NULL);
-	if(out_eocdr->signature == END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE)
+	zip64_end_of_central_directory_record z64eocdr;
+	if(_ReadFileAt(hZip, &z64eocdr, sizeof(zip64_end_of_central_directory_record), z64eocdr_offset) != sizeof(zip64_end_of_central_directory_record)
+			|| z64eocdr.signature != ZIP64_END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE
+			|| z64eocdr.central_directory_start_offset + z64eocdr.central_directory_size > z64eocdr_offset)
 		return;
 
-	uint8_t buffer[SEARCH_BUFFER_SIZE];
-	uint32_t signature = END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE;
-
-	// Work backwards in batches until signature is found, file ends or end of central directory record's max size is reached
-	for(int i = 0; li.QuadPart > 1 && i < MAX_SEARCH_ITERATIONS; i++) {
-		li.QuadPart = MAX(li.QuadPart - SEARCH_BUFFER_SIZE, 1);
-		_SetFilePointerEx(hZip, li, NULL, FILE_BEGIN);
-		_ReadFile(hZip, buffer, SEARCH_BUFFER_SIZE + 3, NULL, NULL);
-
-		for(int j = 0; j < SEARCH_BUFFER_SIZE; j++)
-			if(buffer[j] == END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE_FIRST_BYTE && !memcmp(buffer + j, &signature, sizeof(uint32_t))) {
-				// buffer might not have all the necessary data, in which case read it from file
-				if(j <= SEARCH_BUFFER_SIZE - sizeof(end_of_central_directory_record))
-					memcpy(out_eocdr, buffer + j, sizeof(end_of_central_directory_record));
-				else {
-					li.QuadPart += j;
-					_SetFilePointerEx(hZip, li, NULL, FILE_BEGIN);
-					_ReadFile(hZip, out_eocdr, sizeof(end_of_central_directory_record), NULL, NULL);
-				}
-
-				_CloseHandle(hZip);
-				return;
-			}
+	out_cdl->num_records = z64eocdr.total_num_records;
+	out_cdl->central_directory_size = z64eocdr.central_directory_size;
+	out_cdl->central_directory_start_offset = z64eocdr.central_directory_start_offset;
+	out_cdl->end_records_offset = z64eocdr_offset;
+}
+
+
+/* Header Implementations */
+
+bool find_central_directory(HANDLE hZip, central_directory_location* out_cdl) {
+	LARGE_INTEGER zip_size;
+	_GetFileSizeEx(hZip, &zip_size);
+	if((uint64_t) zip_size.QuadPart < sizeof(end_of_central_directory_record))
+		return false;
+
+	// Read the whole tail the record can be in at once, along with a zip64 locator right before it
+	DWORD tail_size = MIN((uint64_t) zip_size.QuadPart, MAX_TAIL_SIZE);
+	uint64_t tail_offset = zip_size.QuadPart - tail_size;
+
+	uint8_t* tail = Malloc(tail_size);
+	if(_ReadFileAt(hZip, tail, tail_size, tail_offset) != tail_size) {
+		Free(tail);
+		return false;
+	}
+
+	// Work backwards until a valid record is found, most zips have no comment so the first candidate is the last one
+	end_of_central_directory_record eocdr;
+	int64_t eocdr_offset = tail_size - sizeof(end_of_central_directory_record);
+
+	for(;;) {
+		eocdr_offset = find_last_signature(tail, eocdr_offset, END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE);
+		if(eocdr_offset < 0) {
+			Free(tail);
+			return false;
+		}
+
+		memcpy(&eocdr, tail + eocdr_offset, sizeof(end_of_central_directory_record));
+		if(is_valid_end_of_central_directory_record(&eocdr, tail_offset + eocdr_offset, zip_size.QuadPart))
+			break;
+
+		eocdr_offset--;
+	}
+
+	out_cdl->num_records = eocdr.total_num_records;
+	out_cdl->central_directory_size = eocdr.central_directory_size;
+	out_cdl->central_directory_start_offset = eocdr.central_directory_start_offset;
+	out_cdl->end_records_offset = tail_offset + eocdr_offset;
+
+	// Follow the zip64 locator if there is one
+	int64_t locator_offset = eocdr_offset - sizeof(zip64_end_of_central_directory_locator);
+	if(locator_offset >= 0) {
+		zip64_end_of_central_directory_locator z64eocdl;
+		memcpy(&z64eocdl, tail + locator_offset, sizeof(zip64_end_of_central_directory_locator));
+
+		if(z64eocdl.signature == ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE)
+			read_zip64_end_of_central_directory_record(hZip, &z64eocdl, tail_offset + locator_offset, out_cdl);
 	}
-	
-	_CloseHandle(hZip);
-	// error, not found
+
+	Free(tail);
+	return true;
+}
+
+void create_end_of_central_directory_record(end_of_central_directory_record* out_eoccr,
+			uint64_t num_records, uint64_t central_directory_size, uint64_t central_directory_start_offset) {
+	out_eoccr->signature = END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE;
+	out_eoccr->disk_number = 0;
+	out_eoccr->central_directory_start_disk_number = 0;
+	out_eoccr->num_records_on_disk = MIN(num_records, 0xFFFF);
+	out_eoccr->total_num_records = MIN(num_records, 0xFFFF);
+	out_eoccr->central_directory_size = MIN(central_directory_size, 0xFFFFFFFF);
+	out_eoccr->central_directory_start_offset = MIN(central_directory_start_offset, 0xFFFFFFFF);
+	out_eoccr->comment_length = 0;
+}
+
+void create_zip64_end_of_central_directory_record(zip64_end_of_central_directory_record* out_z64eoccr,
+			uint64_t num_records, uint64_t central_directory_size, uint64_t central_directory_start_offset) {
+	out_z64eoccr->signature = ZIP64_END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE;
+	out_z64eoccr->size_of_remaining_zip64_end_of_central_directory_record = ZIP64_END_OF_CENTRAL_DIRECTORY_RECORD_REMAINING_FIXED_FIELDS_SIZE;
+	out_z64eoccr->version_made_by = (WINDOWS_NTFS << 8) | ZIP_VERSION;
+	out_z64eoccr->version_needed_to_extract = ZIP_VERSION;
+	out_z64eoccr->disk_number = 0;
+	out_z64eoccr->central_directory_start_disk_number = 0;
+	out_z64eoccr->num_records_on_disk = num_records;
+	out_z64eoccr->total_num_records = num_records;
+	out_z64eoccr->central_directory_size = central_directory_size;
+	out_z64eoccr->central_directory_start_offset = central_directory_start_offset;
+}
+
+void create_zip64_end_of_central_directory_locator(zip64_end_of_central_directory_locator* out_z64eoccl,
+			uint64_t zip64_end_of_central_directory_start_offset) {
+	out_z64eoccl->signature = ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE;
+	out_z64eoccl->zip64_end_of_central_directory_record_disk_number = 0;
+	out_z64eoccl->zip64_end_of_central_directory_record_offset = zip64_end_of_central_directory_start_offset;
+	out_z64eoccl->total_num_disks = 1;
 }
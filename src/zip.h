@@ -2,15 +2,20 @@
 #define _ZIP_H
 
 #include <stdint.h>
-#include <windows.h>
+#include <stdbool.h>
+#include "platform.h"
 
 #define LOCAL_FILE_HEADER_SIGNATURE 			   	0x04034B50
 #define CENTRAL_DIRECTORY_HEADER_SIGNATURE    		0x02014B50
 #define END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE   0x06054B50
+#define DATA_DESCRIPTOR_SIGNATURE 					0x08074B50
 
 #define ZIP_VERSION  							  	45
+#define ZIP_VERSION_ZSTANDARD 						63 	// Zstandard entries need APPNOTE 6.3.7
 #define WINDOWS_NTFS 							  	0x0A
 #define UTF8_ENCODING 							  	(1 << 11)
+#define HAS_DATA_DESCRIPTOR 						(1 << 3) 	// the CRC and sizes follow the data instead
+#define DEFLATE_OPTIONS 							(3 << 1) 	// the level the data was deflated with, only informative
 
 /* Zip Structs */
 
@@ -30,6 +35,13 @@ typedef struct {
 	//unsigned char extra_field[];
 } __attribute__((packed)) local_file_header;
 
+typedef struct {
+	uint32_t signature;
+	uint32_t crc32;
+	uint32_t compressed_size;
+	uint32_t uncompressed_size;
+} __attribute__((packed)) data_descriptor;
+
 typedef struct {
 	uint32_t signature;
 	uint16_t version_made_by;
@@ -83,6 +95,14 @@ typedef struct {
 	//uint32_t disk_number_start;
 } __attribute__((packed)) zip64_extra_field;
 
+// Used instead of the data descriptor by entries with a zip64 extra field in their local header
+typedef struct {
+	uint32_t signature;
+	uint32_t crc32;
+	uint64_t compressed_size;
+	uint64_t uncompressed_size;
+} __attribute__((packed)) zip64_data_descriptor;
+
 typedef struct {
 	uint32_t signature;
 	uint64_t size_of_remaining_zip64_end_of_central_directory_record;
@@ -104,14 +124,58 @@ typedef struct {
 } __attribute__((packed)) zip64_end_of_central_directory_locator;
 
 
+/* Central Directory Location */
+
+typedef struct {
+	uint64_t num_records;
+	uint64_t central_directory_size;
+	uint64_t central_directory_start_offset;
+	uint64_t end_records_offset; 	// where the (zip64) end of central directory records start
+} central_directory_location;
+
+
 // Functions
 
 /**
- * Returns the end of central directory record of the specified zip file. If not found, returns an empty struct.
+ * Finds the central directory of the specified zip, using the zip64 end of central directory record if there is one.
+ * Takes a single read of the zip's tail, plus one for the zip64 record.
+ * 
+ * @param hZip the zip file
+ * @param out_cdl a pointer to a variable to receive the central directory's location
+ * @return whether a valid end of central directory record was found
+*/
+bool find_central_directory(HANDLE hZip, central_directory_location* out_cdl);
+
+/**
+ * Creates an end of central directory record for the specified central directory, saturating the
+ * values that don't fit, which must then also be in a zip64 end of central directory record.
+ * 
+ * @param out_eoccr a pointer to a variable to receive the record
+ * @param num_records the number of entries in the central directory
+ * @param central_directory_size the size of the central directory
+ * @param central_directory_start_offset the offset of the central directory in the zip
+*/
+void create_end_of_central_directory_record(end_of_central_directory_record* out_eoccr,
+			uint64_t num_records, uint64_t central_directory_size, uint64_t central_directory_start_offset);
+
+/**
+ * Creates a zip64 end of central directory record for the specified central directory.
+ * 
+ * @param out_z64eoccr a pointer to a variable to receive the record
+ * @param num_records the number of entries in the central directory
+ * @param central_directory_size the size of the central directory
+ * @param central_directory_start_offset the offset of the central directory in the zip
+*/
+void create_zip64_end_of_central_directory_record(zip64_end_of_central_directory_record* out_z64eoccr,
+			uint64_t num_records, uint64_t central_directory_size, uint64_t central_directory_start_offset);
+
+/**
+ * Creates a zip64 end of central directory locator pointing to the zip64 record at the specified offset.
  * 
- * @param zip_name the name of the zip file
- * @param out_eocdr a pointer to a variable to receive the end of central directory record
+ * @param out_z64eoccl a pointer to a variable to receive the locator
+ * @param zip64_end_of_central_directory_start_offset the offset of the zip64 end of central directory record in the zip
 */
-void find_end_of_central_directory_record(LPWSTR zip_name, end_of_central_directory_record* out_eocdr);
+void create_zip64_end_of_central_directory_locator(zip64_end_of_central_directory_locator* out_z64eoccl,
+			uint64_t zip64_end_of_central_directory_start_offset);
 
 #endif
@@ -0,0 +1,192 @@
+#include <string.h>
+#include "zip_index.h"
+#include "utils.h"
+#include "wrapper_functions.h"
+
+#define MAX_READ_SIZE 		(1 << 30)
+
+#define FNV_OFFSET_BASIS 	0xCBF29CE484222325ULL
+#define FNV_PRIME 			0x100000001B3ULL
+
+
+/* Helper Functions */
+
+static uint64_t hash_name(const char* name, size_t length) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for(size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char) name[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * Replaces the entry's saturated sizes and offset with the ones in its zip64 extra field, which
+ * only holds the fields that didn't fit, in this order. Returns false if the extra field is corrupt.
+*/
+static bool apply_zip64_extra_field(zip_entry* ze, const unsigned char* extra_field, uint16_t extra_field_length) {
+	uint16_t pos = 0;
+
+	while(pos + ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE <= extra_field_length) {
+		uint16_t header_id, data_size;
+		memcpy(&header_id, extra_field + pos, sizeof(uint16_t));
+		memcpy(&data_size, extra_field + pos + sizeof(uint16_t), sizeof(uint16_t));
+		pos += ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE;
+
+		if(pos + data_size > extra_field_length)
+			return false;
+
+		if(header_id == ZIP64_EXTRA_FIELD_HEADER_ID) {
+			uint64_t* fields[] = {&ze->uncompressed_size, &ze->compressed_size, &ze->local_header_offset};
+			uint16_t field_pos = 0;
+
+			for(unsigned i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+				if(*fields[i] == 0xFFFFFFFF) {
+					if(field_pos + sizeof(uint64_t) > data_size)
+						return false;
+					memcpy(fields[i], extra_field + pos + field_pos, sizeof(uint64_t));
+					field_pos += sizeof(uint64_t);
+				}
+
+			return true;
+		}
+
+		pos += data_size;
+	}
+
+	return true;
+}
+
+static void index_entry(zip_index* zi, uint64_t entry_index) {
+	const zip_entry* ze = zi->entries + entry_index;
+	uint64_t mask = zi->num_buckets - 1;
+
+	for(uint64_t bucket = hash_name(zip_entry_name(zi, ze), ze->name_length) & mask; ; bucket = (bucket + 1) & mask) {
+		if(zi->buckets[bucket] == 0) {
+			zi->buckets[bucket] = entry_index + 1;
+			return;
+		}
+
+		// Keep the first of the entries with the same name
+		const zip_entry* other = zi->entries + zi->buckets[bucket] - 1;
+		if(other->name_length == ze->name_length && !memcmp(zip_entry_name(zi, other), zip_entry_name(zi, ze), ze->name_length))
+			return;
+	}
+}
+
+
+/* Header Implementations */
+
+unsigned char* load_central_directory(HANDLE hZip, uint64_t central_directory_start_offset, uint64_t central_directory_size) {
+	unsigned char* cd = Malloc(central_directory_size + 1);
+	for(uint64_t total_bytes_read = 0; total_bytes_read < central_directory_size; ) {
+		DWORD batch_size = MIN(MAX_READ_SIZE, central_directory_size - total_bytes_read);
+		DWORD bytes_read = _ReadFileAt(hZip, cd + total_bytes_read, batch_size, central_directory_start_offset + total_bytes_read);
+
+		if(bytes_read == 0) {
+			Free(cd);
+			return NULL;
+		}
+
+		total_bytes_read += bytes_read;
+	}
+
+	return cd;
+}
+
+zip_index* zip_index_load(HANDLE hZip, uint64_t central_directory_start_offset, uint64_t central_directory_size, uint64_t num_entries) {
+	unsigned char* cd = load_central_directory(hZip, central_directory_start_offset, central_directory_size);
+	if(cd == NULL)
+		return NULL;
+
+	zip_index* zi = zip_index_parse(cd, central_directory_size, num_entries);
+	Free(cd);
+	return zi;
+}
+
+zip_index* zip_index_parse(const unsigned char* cd, uint64_t central_directory_size, uint64_t num_entries) {
+	// Every entry takes at least a central directory header, which also bounds the allocations below
+	if(num_entries > central_directory_size / sizeof(central_directory_header))
+		return NULL;
+
+	zip_index* zi = Malloc(sizeof(zip_index));
+	zi->entries = Malloc(MAX(num_entries, 1) * sizeof(zip_entry));
+	zi->num_entries = num_entries;
+	zi->buckets = NULL;
+
+	// The names are never longer than the central directory they come from, with their null terminators
+	// taking the place of the headers' fixed fields
+	zi->names = Malloc(central_directory_size + 1);
+	uint64_t names_size = 0;
+
+	uint64_t pos = 0;
+	for(uint64_t i = 0; i < num_entries; i++) {
+		const central_directory_header* cdh = (const central_directory_header*)(cd + pos);
+
+		if(pos + sizeof(central_directory_header) > central_directory_size || cdh->signature != CENTRAL_DIRECTORY_HEADER_SIGNATURE
+				|| pos + sizeof(central_directory_header) + cdh->file_name_length + cdh->extra_field_length + cdh->file_comment_length > central_directory_size) {
+			zip_index_destroy(zi);
+			return NULL;
+		}
+
+		const unsigned char* name = cd + pos + sizeof(central_directory_header);
+		const unsigned char* extra_field = name + cdh->file_name_length;
+
+		zip_entry* ze = zi->entries + i;
+		ze->compressed_size = cdh->compressed_size;
+		ze->uncompressed_size = cdh->uncompressed_size;
+		ze->local_header_offset = cdh->local_header_offset;
+		ze->crc32 = cdh->crc32;
+		ze->external_file_attributes = cdh->external_file_attributes;
+		ze->name_offset = names_size;
+		ze->name_length = cdh->file_name_length;
+		ze->flags = cdh->flags;
+		ze->compression = cdh->compression;
+		ze->mod_time = cdh->mod_time;
+		ze->mod_date = cdh->mod_date;
+
+		if(!apply_zip64_extra_field(ze, extra_field, cdh->extra_field_length)) {
+			zip_index_destroy(zi);
+			return NULL;
+		}
+
+		memcpy(zi->names + names_size, name, cdh->file_name_length);
+		names_size += cdh->file_name_length;
+		zi->names[names_size++] = '\0';
+
+		pos += sizeof(central_directory_header) + cdh->file_name_length + cdh->extra_field_length + cdh->file_comment_length;
+	}
+
+	zi->names = Realloc(zi->names, MAX(names_size, 1));
+
+	// Keep the table at most half full so probe sequences stay short
+	zi->num_buckets = 1;
+	while(zi->num_buckets < num_entries * 2)
+		zi->num_buckets *= 2;
+	zi->buckets = Calloc(zi->num_buckets, sizeof(uint64_t));
+
+	for(uint64_t i = 0; i < num_entries; i++)
+		index_entry(zi, i);
+
+	return zi;
+}
+
+const zip_entry* zip_index_lookup(const zip_index* zi, const char* name) {
+	size_t name_length = strlen(name);
+	uint64_t mask = zi->num_buckets - 1;
+
+	for(uint64_t bucket = hash_name(name, name_length) & mask; zi->buckets[bucket] != 0; bucket = (bucket + 1) & mask) {
+		const zip_entry* ze = zi->entries + zi->buckets[bucket] - 1;
+		if(ze->name_length == name_length && !memcmp(zip_entry_name(zi, ze), name, name_length))
+			return ze;
+	}
+
+	return NULL;
+}
+
+void zip_index_destroy(zip_index* zi) {
+	Free(zi->buckets);
+	Free(zi->entries);
+	Free(zi->names);
+	Free(zi);
+}
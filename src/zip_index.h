@@ -0,0 +1,105 @@
+#ifndef _ZIP_INDEX_H
+#define _ZIP_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "platform.h"
+#include "zip.h"
+
+/*
+ * In-memory index of a zip's central directory.
+ *
+ * The whole central directory is read at once and parsed into a compact array of entries, in
+ * archive order, whose names are kept in a single pool. Names are hashed into an open addressing
+ * table so any entry can be found without scanning the others.
+ */
+
+typedef struct {
+	uint64_t compressed_size;
+	uint64_t uncompressed_size;
+	uint64_t local_header_offset; 	// zip64 values already applied
+	uint32_t crc32;
+	uint32_t external_file_attributes;
+	uint64_t name_offset; 			// in the name pool, names are null-terminated UTF-8
+	uint16_t name_length;
+	uint16_t flags;
+	uint16_t compression;
+	uint16_t mod_time;
+	uint16_t mod_date;
+} zip_entry;
+
+typedef struct {
+	zip_entry* entries;
+	uint64_t num_entries;
+
+	char* names;
+
+	uint64_t* buckets; 		// entry index + 1, 0 for empty buckets
+	uint64_t num_buckets; 	// a power of two
+} zip_index;
+
+
+/**
+ * Reads the central directory of the specified zip and indexes its entries. Returns NULL if the
+ * central directory is corrupt.
+ *
+ * @param hZip the zip file
+ * @param central_directory_start_offset the offset of the central directory in the zip
+ * @param central_directory_size the size of the central directory
+ * @param num_entries the number of entries in the central directory
+ * @return the zip's index, or NULL if the central directory is corrupt
+*/
+zip_index* zip_index_load(HANDLE hZip, uint64_t central_directory_start_offset, uint64_t central_directory_size, uint64_t num_entries);
+
+/**
+ * Reads the whole central directory of the specified zip into memory and returns it, or NULL if
+ * it's cut short.
+ *
+ * @param hZip the zip file
+ * @param central_directory_start_offset the offset of the central directory in the zip
+ * @param central_directory_size the size of the central directory
+ * @return the central directory, to be freed by the caller, or NULL if it's cut short
+*/
+unsigned char* load_central_directory(HANDLE hZip, uint64_t central_directory_start_offset, uint64_t central_directory_size);
+
+/**
+ * Indexes the entries of the specified central directory, already read into memory. Returns NULL
+ * if it's corrupt.
+ *
+ * @param central_directory the central directory
+ * @param central_directory_size the size of the central directory
+ * @param num_entries the number of entries in the central directory
+ * @return the central directory's index, or NULL if it's corrupt
+*/
+zip_index* zip_index_parse(const unsigned char* central_directory, uint64_t central_directory_size, uint64_t num_entries);
+
+/**
+ * Returns the entry with the specified name, or NULL if there is none. Directory names end with
+ * a slash. If several entries share the name, the first one is returned.
+ *
+ * @param zi the zip's index
+ * @param name the entry's UTF-8 name, as stored in the zip
+ * @return the entry, or NULL if there is none
+*/
+const zip_entry* zip_index_lookup(const zip_index* zi, const char* name);
+
+/**
+ * Returns the specified entry's null-terminated UTF-8 name.
+*/
+static inline const char* zip_entry_name(const zip_index* zi, const zip_entry* ze) {
+	return zi->names + ze->name_offset;
+}
+
+/**
+ * Returns whether the specified entry is a directory.
+*/
+static inline bool zip_entry_is_directory(const zip_index* zi, const zip_entry* ze) {
+	return ze->name_length > 0 && zip_entry_name(zi, ze)[ze->name_length - 1] == '/';
+}
+
+/**
+ * Frees the specified zip index.
+*/
+void zip_index_destroy(zip_index* zi);
+
+#endif
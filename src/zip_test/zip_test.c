@@ -0,0 +1,241 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include "../platform.h"
+#include "../zip.h"
+#include "../zip_index.h"
+#include "../compression/compression.h"
+#include "../compression/concurrency.h"
+#include "../compression/thread_pool.h"
+#include "../wrapper_functions.h"
+#include "../utils.h"
+
+#define IN_FLIGHT_ENTRIES_PER_THREAD 	16
+#define MAX_ERROR_LENGTH 				128
+
+typedef struct {
+	LPTSTR zip_name;
+	HANDLE hZip;
+	zip_index* zi;
+	uint64_t central_directory_start_offset;
+} tester_context;
+
+typedef struct {
+	const tester_context* tc;
+	const zip_entry* ze;
+	char error[MAX_ERROR_LENGTH]; 	// empty if the entry is intact
+} entry_test;
+
+
+/* Helper Functions */
+
+static void set_error(entry_test* et, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	vsnprintf(et->error, MAX_ERROR_LENGTH, format, args);
+	va_end(args);
+}
+
+/**
+ * Checks that the local file header matches the entry's central directory header and returns the offset of the
+ * entry's data, or 0 if they don't match.
+*/
+static uint64_t check_local_file_header(entry_test* et, local_file_header* out_lfh) {
+	const tester_context* tc = et->tc;
+	const zip_entry* ze = et->ze;
+
+	if(_ReadFileAt(tc->hZip, out_lfh, sizeof(local_file_header), ze->local_header_offset) != sizeof(local_file_header)
+			|| out_lfh->signature != LOCAL_FILE_HEADER_SIGNATURE) {
+		set_error(et, "local file header not found");
+		return 0;
+	}
+
+	if(out_lfh->file_name_length != ze->name_length) {
+		set_error(et, "local file name doesn't match");
+		return 0;
+	}
+
+	char* name = Malloc(MAX(ze->name_length, 1));
+	_ReadFileAt(tc->hZip, name, ze->name_length, ze->local_header_offset + sizeof(local_file_header));
+	bool names_match = !memcmp(name, zip_entry_name(tc->zi, ze), ze->name_length);
+	Free(name);
+
+	if(!names_match) {
+		set_error(et, "local file name doesn't match");
+		return 0;
+	}
+
+	if(out_lfh->compression != ze->compression) {
+		set_error(et, "local compression method doesn't match");
+		return 0;
+	}
+
+	// The CRC32 and sizes are in the data descriptor instead, saturated sizes in the zip64 extra field
+	if(!(out_lfh->flags & HAS_DATA_DESCRIPTOR)) {
+		if(out_lfh->crc32 != ze->crc32) {
+			set_error(et, "local CRC32 doesn't match");
+			return 0;
+		}
+
+		if((out_lfh->compressed_size != 0xFFFFFFFF && out_lfh->compressed_size != ze->compressed_size)
+				|| (out_lfh->uncompressed_size != 0xFFFFFFFF && out_lfh->uncompressed_size != ze->uncompressed_size)) {
+			set_error(et, "local sizes don't match");
+			return 0;
+		}
+	}
+
+	uint64_t data_offset = ze->local_header_offset + sizeof(local_file_header) + out_lfh->file_name_length + out_lfh->extra_field_length;
+	if(data_offset + ze->compressed_size > tc->central_directory_start_offset) {
+		set_error(et, "data overlaps the central directory");
+		return 0;
+	}
+
+	return data_offset;
+}
+
+/**
+ * Checks the CRC32 in the data descriptor following the entry's data, whose signature is optional.
+*/
+static bool check_data_descriptor(entry_test* et, uint64_t data_descriptor_offset) {
+	uint32_t fields[2] = {0};
+	_ReadFileAt(et->tc->hZip, fields, sizeof(fields), data_descriptor_offset);
+
+	uint32_t crc32 = fields[0] == DATA_DESCRIPTOR_SIGNATURE ? fields[1] : fields[0];
+	if(crc32 != et->ze->crc32) {
+		set_error(et, "data descriptor doesn't match");
+		return false;
+	}
+
+	return true;
+}
+
+
+/* Main Functions */
+
+static void test_entry(void* data) {
+	entry_test* et = (entry_test*) data;
+	const zip_entry* ze = et->ze;
+
+	local_file_header lfh;
+	uint64_t data_offset = check_local_file_header(et, &lfh);
+	if(data_offset == 0)
+		return;
+
+	if((lfh.flags & HAS_DATA_DESCRIPTOR) && !check_data_descriptor(et, data_offset + ze->compressed_size))
+		return;
+
+	// Empty files have no data to decompress
+	decompression_result dr = {0, 0, true};
+	if(ze->compressed_size > 0)
+		switch(ze->compression) {
+			case(NO_COMPRESSION): dr = no_compression_decompress(et->tc->zip_name, NULL, data_offset, ze->compressed_size); break;
+			case(DEFLATE): dr = deflate_decompress(et->tc->zip_name, NULL, data_offset, ze->compressed_size); break;
+#ifdef ZSTANDARD_SUPPORTED
+			case(ZSTANDARD): dr = zstd_decompress(et->tc->zip_name, NULL, data_offset, ze->compressed_size); break;
+#endif
+			default: set_error(et, "unsupported compression method %hu", ze->compression); return;
+		}
+
+	if(!dr.valid)
+		set_error(et, "compressed data is corrupt");
+	else if(dr.destination_size != ze->uncompressed_size)
+		set_error(et, "uncompressed size doesn't match (expected %llu, got %llu)", (unsigned long long) ze->uncompressed_size, (unsigned long long) dr.destination_size);
+	else if(dr.crc32 != ze->crc32)
+		set_error(et, "CRC32 doesn't match (expected %08x, got %08x)", ze->crc32, dr.crc32);
+}
+
+/**
+ * Tests every entry on the thread pool, keeping a bounded number of them in flight, reports the failures in archive
+ * order and returns their number. Large stored entries are further split across cores by the codec.
+*/
+static uint64_t test_entries(const tester_context* tc) {
+	uint64_t num_entries = tc->zi->num_entries;
+	entry_test* tests = Calloc(MAX(num_entries, 1), sizeof(entry_test));
+	wait_group* wgs = Calloc(MAX(num_entries, 1), sizeof(wait_group));
+
+	uint64_t max_in_flight_entries = num_cores() * IN_FLIGHT_ENTRIES_PER_THREAD;
+	uint64_t next_entry = 0, num_failures = 0;
+
+	for(uint64_t i = 0; i < num_entries; i++) {
+		// Schedule the following entries, the waits below run them too
+		for(; next_entry < num_entries && next_entry < i + max_in_flight_entries; next_entry++) {
+			tests[next_entry].tc = tc;
+			tests[next_entry].ze = tc->zi->entries + next_entry;
+			thread_pool_submit(wgs + next_entry, test_entry, tests + next_entry);
+		}
+
+		wait_group_wait(wgs + i);
+
+		if(tests[i].error[0] != '\0') {
+			printf("%s: %s\n", zip_entry_name(tc->zi, tests[i].ze), tests[i].error);
+			num_failures++;
+		}
+	}
+
+	Free(wgs);
+	Free(tests);
+	return num_failures;
+}
+
+int _tmain(int argc, TCHAR* argv[]) {
+	int arg = 1;
+
+	// Parse options: -j sets the number of threads, which defaults to the number of cores
+	for(; arg < argc && argv[arg][0] == TEXT('-') && argv[arg][1] != TEXT('\0'); arg++) {
+		LPTSTR threads_end;
+		long num_threads = 0;
+
+		if(argv[arg][1] == TEXT('j') && argv[arg][2] == TEXT('\0') && arg + 1 < argc)
+			num_threads = _tcstol(argv[++arg], &threads_end, 10);
+
+		if(num_threads < 1 || *threads_end != TEXT('\0')) {
+			argc = 0;
+			break;
+		}
+
+		set_num_cores(num_threads);
+	}
+
+	if(argc - arg != 1) {
+		printf("Usage: zip_test [-j threads] archive_name\n");
+		return 0;
+	}
+
+	tester_context tc;
+	tc.zip_name = argv[arg];
+	tc.hZip = _CreateFile(tc.zip_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	central_directory_location cdl;
+	if(!find_central_directory(tc.hZip, &cdl)) {
+		printf("End of central directory record not found\n");
+		return 1;
+	}
+
+	tc.central_directory_start_offset = cdl.central_directory_start_offset;
+	tc.zi = zip_index_load(tc.hZip, cdl.central_directory_start_offset, cdl.central_directory_size, cdl.num_records);
+	if(tc.zi == NULL) {
+		printf("Central directory is corrupt\n");
+		return 1;
+	}
+
+	uint64_t total_size = 0;
+	for(uint64_t i = 0; i < tc.zi->num_entries; i++)
+		total_size += tc.zi->entries[i].compressed_size;
+
+	ULONGLONG start_time = GetTickCount64();
+	uint64_t num_failures = test_entries(&tc);
+	ULONGLONG elapsed_time = MAX(GetTickCount64() - start_time, 1);
+
+	printf("Tested %llu entries, %.1f MB in %.3f s (%.1f MB/s)\n", (unsigned long long) tc.zi->num_entries, total_size / 1e6, elapsed_time / 1e3, total_size / 1e3 / elapsed_time);
+	if(num_failures > 0)
+		printf("%llu entries failed\n", (unsigned long long) num_failures);
+	else
+		printf("No errors found\n");
+
+	zip_index_destroy(tc.zi);
+	_CloseHandle(tc.hZip);
+	return num_failures > 0;
+}
@@ -0,0 +1,53 @@
+#include <stdint.h>
+#include "arena.h"
+#include "../wrapper_functions.h"
+#include "../utils.h"
+
+#define ARENA_CHUNK_SIZE 	(1024 * 1024)
+#define ARENA_ALIGNMENT 	sizeof(void*)
+
+struct arena_chunk {
+	arena_chunk* previous;
+	void* data[]; 	// aligned for any pointer
+};
+
+
+/* Helper Functions */
+
+static void add_chunk(arena* a, size_t size) {
+	arena_chunk* chunk = Malloc(sizeof(arena_chunk) + size);
+	chunk->previous = a->chunks;
+
+	a->chunks = chunk;
+	a->used = 0;
+	a->chunk_size = size;
+}
+
+
+/* Header Implementations */
+
+arena* arena_create() {
+	return Calloc(1, sizeof(arena));
+}
+
+void* arena_alloc(arena* a, size_t size) {
+	size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+	// Allocations larger than a chunk get a chunk of their own
+	if(a->chunks == NULL || size > a->chunk_size - a->used)
+		add_chunk(a, MAX(size, ARENA_CHUNK_SIZE));
+
+	void* p = (unsigned char*) a->chunks->data + a->used;
+	a->used += size;
+	return p;
+}
+
+void arena_destroy(arena* a) {
+	while(a->chunks != NULL) {
+		arena_chunk* previous = a->chunks->previous;
+		Free(a->chunks);
+		a->chunks = previous;
+	}
+
+	Free(a);
+}
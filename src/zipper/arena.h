@@ -0,0 +1,45 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Bump allocator for many small allocations that are all freed together.
+ *
+ * Memory is handed out from large chunks, so each allocation costs a pointer increment
+ * instead of a call to the system allocator, and carries no per-allocation overhead.
+ */
+
+typedef struct arena_chunk arena_chunk;
+
+typedef struct {
+	arena_chunk* chunks; 	// the current chunk, which links to the previous ones
+	size_t used; 			// bytes used in the current chunk
+	size_t chunk_size; 		// usable bytes in the current chunk
+} arena;
+
+/**
+ * Creates and returns a pointer to a new, empty arena.
+ *
+ * @return a pointer to a new arena
+*/
+arena* arena_create();
+
+/**
+ * Returns a pointer to the specified number of bytes allocated from the specified arena, aligned
+ * for any pointer. The memory is uninitialized and stays valid until the arena is destroyed.
+ *
+ * @param a the arena to allocate from
+ * @param size the number of bytes to allocate
+ * @return a pointer to the allocated memory
+*/
+void* arena_alloc(arena* a, size_t size);
+
+/**
+ * Destroys the specified arena, freeing every allocation made from it.
+ *
+ * @param a the arena to destroy
+*/
+void arena_destroy(arena* a);
+
+#endif
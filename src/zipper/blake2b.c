@@ -0,0 +1,141 @@
+#include <string.h>
+#include "blake2b.h"
+
+#define NUM_ROUNDS 12
+
+static const uint64_t blake2b_iv[8] = {
+	0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+	0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL
+};
+
+static const unsigned char sigma[NUM_ROUNDS][16] = {
+	{ 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+	{14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+	{11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4},
+	{ 7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8},
+	{ 9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13},
+	{ 2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9},
+	{12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11},
+	{13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10},
+	{ 6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5},
+	{10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0},
+	{ 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+	{14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3}
+};
+
+
+/* Helper Functions */
+
+static uint64_t rotr64(uint64_t x, unsigned n) {
+	return (x >> n) | (x << (64 - n));
+}
+
+static uint64_t load64(const unsigned char* p) {
+	uint64_t x = 0;
+	for(unsigned i = 0; i < 8; i++)
+		x |= (uint64_t) p[i] << (8 * i);
+	return x;
+}
+
+#define G(a, b, c, d, x, y) 					\
+	do { 										\
+		v[a] = v[a] + v[b] + (x); 				\
+		v[d] = rotr64(v[d] ^ v[a], 32); 		\
+		v[c] = v[c] + v[d]; 					\
+		v[b] = rotr64(v[b] ^ v[c], 24); 		\
+		v[a] = v[a] + v[b] + (y); 				\
+		v[d] = rotr64(v[d] ^ v[a], 16); 		\
+		v[c] = v[c] + v[d]; 					\
+		v[b] = rotr64(v[b] ^ v[c], 63); 		\
+	} while(0)
+
+/**
+ * Mixes the specified block into the state. The last block is flagged, and only it may be short.
+*/
+static void compress(blake2b_state* state, const unsigned char* block, int is_last) {
+	uint64_t m[16], v[16];
+
+	for(unsigned i = 0; i < 16; i++)
+		m[i] = load64(block + 8 * i);
+
+	for(unsigned i = 0; i < 8; i++) {
+		v[i] = state->h[i];
+		v[i + 8] = blake2b_iv[i];
+	}
+	v[12] ^= state->t[0];
+	v[13] ^= state->t[1];
+	if(is_last)
+		v[14] = ~v[14];
+
+	for(unsigned r = 0; r < NUM_ROUNDS; r++) {
+		const unsigned char* s = sigma[r];
+		G(0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);
+		G(1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);
+		G(2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);
+		G(3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);
+		G(0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);
+		G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+		G(2, 7,  8, 13, m[s[12]], m[s[13]]);
+		G(3, 4,  9, 14, m[s[14]], m[s[15]]);
+	}
+
+	for(unsigned i = 0; i < 8; i++)
+		state->h[i] ^= v[i] ^ v[i + 8];
+}
+
+static void add_to_counter(blake2b_state* state, uint64_t length) {
+	state->t[0] += length;
+	if(state->t[0] < length)
+		state->t[1]++;
+}
+
+
+/* Header Implementations */
+
+void blake2b_init(blake2b_state* state, size_t digest_size) {
+	memset(state, 0, sizeof(blake2b_state));
+	memcpy(state->h, blake2b_iv, sizeof(blake2b_iv));
+
+	// Parameter block: digest size, no key, fanout and depth of 1
+	state->h[0] ^= 0x01010000 ^ digest_size;
+	state->digest_size = digest_size;
+}
+
+void blake2b_update(blake2b_state* state, const void* data, size_t length) {
+	const unsigned char* in = data;
+
+	// The buffered block is only compressed once more data follows it, since the last block is flagged
+	while(length > 0) {
+		if(state->buffer_length == BLAKE2B_BLOCK_SIZE) {
+			add_to_counter(state, BLAKE2B_BLOCK_SIZE);
+			compress(state, state->buffer, 0);
+			state->buffer_length = 0;
+		}
+
+		// Whole blocks are compressed straight from the data, as long as more follows them
+		if(state->buffer_length == 0) {
+			for(; length > BLAKE2B_BLOCK_SIZE; in += BLAKE2B_BLOCK_SIZE, length -= BLAKE2B_BLOCK_SIZE) {
+				add_to_counter(state, BLAKE2B_BLOCK_SIZE);
+				compress(state, in, 0);
+			}
+		}
+
+		size_t size = BLAKE2B_BLOCK_SIZE - state->buffer_length;
+		if(size > length)
+			size = length;
+
+		memcpy(state->buffer + state->buffer_length, in, size);
+		state->buffer_length += size;
+		in += size;
+		length -= size;
+	}
+}
+
+void blake2b_final(blake2b_state* state, unsigned char* out_digest) {
+	add_to_counter(state, state->buffer_length);
+	memset(state->buffer + state->buffer_length, 0, BLAKE2B_BLOCK_SIZE - state->buffer_length);
+	compress(state, state->buffer, 1);
+
+	for(size_t i = 0; i < state->digest_size; i++)
+		out_digest[i] = state->h[i / 8] >> (8 * (i % 8));
+}
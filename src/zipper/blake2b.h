@@ -0,0 +1,48 @@
+#ifndef _BLAKE2B_H
+#define _BLAKE2B_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * BLAKE2b (RFC 7693), unkeyed, for telling contents apart by their digests where colliding
+ * ones would substitute one content for another.
+ */
+
+#define BLAKE2B_BLOCK_SIZE 		128
+#define BLAKE2B_MAX_DIGEST_SIZE 64
+
+typedef struct {
+	uint64_t h[8];
+	uint64_t t[2]; 						// the number of bytes hashed
+	unsigned char buffer[BLAKE2B_BLOCK_SIZE];
+	size_t buffer_length;
+	size_t digest_size;
+} blake2b_state;
+
+/**
+ * Starts a new digest of the specified size.
+ *
+ * @param state the state to initialize
+ * @param digest_size the size of the digest, from 1 to BLAKE2B_MAX_DIGEST_SIZE bytes
+*/
+void blake2b_init(blake2b_state* state, size_t digest_size);
+
+/**
+ * Adds the specified data to the digest.
+ *
+ * @param state the digest's state
+ * @param data the data to add
+ * @param length the number of bytes of data
+*/
+void blake2b_update(blake2b_state* state, const void* data, size_t length);
+
+/**
+ * Finishes the digest and writes it to the specified buffer, of the digest's size.
+ *
+ * @param state the digest's state, which can't be updated anymore
+ * @param out_digest a pointer to a buffer to receive the digest
+*/
+void blake2b_final(blake2b_state* state, unsigned char* out_digest);
+
+#endif
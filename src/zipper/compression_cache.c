@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "compression_cache.h"
+#include "../compression/crc32.h"
+#include "../wrapper_functions.h"
+#include "../utils.h"
+
+#define CACHED_PAYLOAD_SIGNATURE 	0x43435A4D 	// "MZCC"
+#define MAX_KEY_NAME_LENGTH 		96
+#define COPY_BUFFER_SIZE 			4 * 1024 * 1024
+#define TRIMMED_SIZE(max_size) 		((max_size) / 8 * 7) 	// trimming leaves room for a few more payloads
+
+#define TEMPORARY_FILE_PREFIX 		TEXT("tmp-")
+#define STALE_TEMPORARY_FILE_AGE 	(60ULL * 60 * 10000000) 	// an hour, in FILETIME ticks
+
+typedef struct {
+	uint32_t signature;
+	unsigned char digest[COMPRESSION_CACHE_DIGEST_SIZE];
+	uint32_t crc32;
+	uint64_t compressed_size;
+	uint16_t compression_method;
+} __attribute__((packed)) cached_payload_header;
+
+typedef struct {
+	LPTSTR name;
+	uint64_t size;
+	uint64_t last_write_time;
+} cache_file;
+
+
+/* Helper Functions */
+
+static void set_key_name(const compression_cache* cc, const compression_cache_key* key, LPTSTR out_name) {
+	for(unsigned i = 0; i < COMPRESSION_CACHE_DIGEST_SIZE; i++)
+		_sntprintf(out_name + 2 * i, 3, TEXT("%02x"), key->digest[i]);
+
+	_sntprintf(out_name + 2 * COMPRESSION_CACHE_DIGEST_SIZE, MAX_KEY_NAME_LENGTH - 2 * COMPRESSION_CACHE_DIGEST_SIZE,
+		TEXT("-%u-%d"), (unsigned) key->compression_method, cc->level);
+}
+
+static uint64_t file_time_to_uint64(const FILETIME* ft) {
+	return (uint64_t) ft->dwHighDateTime << 32 | ft->dwLowDateTime;
+}
+
+static int compare_cache_files(const void* a, const void* b) {
+	uint64_t time_a = ((const cache_file*) a)->last_write_time;
+	uint64_t time_b = ((const cache_file*) b)->last_write_time;
+	return (time_a > time_b) - (time_a < time_b);
+}
+
+/**
+ * Lists the cache's directory, sets the cache's size to the total size of its payloads and, if it's over the
+ * size bound, deletes the least recently used ones. Temporary files are left to the processes writing them,
+ * unless they're so old that their process must be gone. The cache's lock isn't held while the directory is
+ * listed, only one thread trims at a time and the others keep storing payloads meanwhile.
+*/
+static void trim(compression_cache* cc) {
+	TCHAR pattern[MAX_PATH + 1];
+	_sntprintf(pattern, MAX_PATH + 1, TEXT("%s*"), cc->path);
+
+	EnterCriticalSection(&cc->lock);
+	uint64_t size_before = cc->size;
+	LeaveCriticalSection(&cc->lock);
+
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+
+	cache_file* files = NULL;
+	size_t num_files = 0, capacity = 0;
+	uint64_t size = 0;
+
+	WIN32_FIND_DATA ffd;
+	HANDLE hFind = FindFirstFile(pattern, &ffd);
+	if(hFind != INVALID_HANDLE_VALUE) {
+		do {
+			if(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				continue;
+
+			if(num_files == capacity) {
+				capacity = capacity == 0 ? 64 : capacity * 2;
+				files = Realloc(files, capacity * sizeof(cache_file));
+			}
+
+			cache_file* file = files + num_files;
+			size_t name_length = _tcslen(ffd.cFileName);
+			file->name = Malloc((cc->path_length + name_length + 1) * sizeof(TCHAR));
+			memcpy(file->name, cc->path, cc->path_length * sizeof(TCHAR));
+			memcpy(file->name + cc->path_length, ffd.cFileName, (name_length + 1) * sizeof(TCHAR));
+			file->size = (uint64_t) ffd.nFileSizeHigh << 32 | ffd.nFileSizeLow;
+			file->last_write_time = file_time_to_uint64(&ffd.ftLastWriteTime);
+
+			if(_tcsncmp(ffd.cFileName, TEMPORARY_FILE_PREFIX, _tcslen(TEMPORARY_FILE_PREFIX)) == 0) {
+				if(file->last_write_time + STALE_TEMPORARY_FILE_AGE < file_time_to_uint64(&now))
+					DeleteFile(file->name);
+				Free(file->name);
+				continue;
+			}
+
+			size += file->size;
+			num_files++;
+		} while(FindNextFile(hFind, &ffd));
+
+		FindClose(hFind);
+	}
+
+	// Files that are already gone, deleted by another process, count as deleted
+	if(size > cc->max_size) {
+		qsort(files, num_files, sizeof(cache_file), compare_cache_files);
+
+		for(size_t i = 0; i < num_files && size > TRIMMED_SIZE(cc->max_size); i++) {
+			DeleteFile(files[i].name);
+			size -= files[i].size;
+		}
+	}
+
+	for(size_t i = 0; i < num_files; i++)
+		Free(files[i].name);
+	Free(files);
+
+	// Payloads stored while the directory was listed may be counted twice, which only makes the next trim come sooner
+	EnterCriticalSection(&cc->lock);
+	cc->size = size + (cc->size - size_before);
+	cc->trimming = false;
+	LeaveCriticalSection(&cc->lock);
+}
+
+/**
+ * Opens the payload with the specified key and returns its file, positioned nowhere in particular, or NULL if it
+ * isn't cached or its file is damaged. Refreshes the file's last write time, which is when it was last used.
+*/
+static HANDLE open_payload(compression_cache* cc, const compression_cache_key* key, cached_payload* out_cp) {
+	TCHAR name[MAX_PATH];
+	memcpy(name, cc->path, cc->path_length * sizeof(TCHAR));
+	set_key_name(cc, key, name + cc->path_length);
+
+	// The file's times are set through the handle, unless the cache is read only to this process
+	HANDLE hFile = CreateFile(name, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE && GetLastError() == ERROR_ACCESS_DENIED)
+		hFile = CreateFile(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	cached_payload_header cph;
+	LARGE_INTEGER file_size;
+	_GetFileSizeEx(hFile, &file_size);
+
+	// The key is checked again, so a file that ended up under another payload's name is never taken for it
+	if(_ReadFileAt(hFile, &cph, sizeof(cached_payload_header), 0) != sizeof(cached_payload_header) || cph.signature != CACHED_PAYLOAD_SIGNATURE
+			|| memcmp(cph.digest, key->digest, COMPRESSION_CACHE_DIGEST_SIZE) != 0 || cph.crc32 != key->crc32
+			|| (uint64_t) file_size.QuadPart != sizeof(cached_payload_header) + cph.compressed_size) {
+		_CloseHandle(hFile);
+		return NULL;
+	}
+
+	// Record the use. Payloads of a read only cache can't be refreshed, but then they aren't evicted by this process either
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	if(!SetFileTime(hFile, NULL, NULL, &now) && GetLastError() != ERROR_ACCESS_DENIED)
+		exit_with_error("SetFileTime error: %lu\n", GetLastError());
+
+	out_cp->compression_method = cph.compression_method;
+	out_cp->compressed_size = cph.compressed_size;
+	return hFile;
+}
+
+/**
+ * Creates a temporary file in the cache's directory, writes the specified payload's header to it, and returns it,
+ * or NULL if it couldn't be created. Its name is written to the specified buffer, of MAX_PATH + MAX_KEY_NAME_LENGTH characters.
+*/
+static HANDLE create_payload(compression_cache* cc, const compression_cache_key* key, const cached_payload* cp, LPTSTR out_temp_name) {
+	EnterCriticalSection(&cc->lock);
+	uint64_t store = cc->num_stores++;
+	LeaveCriticalSection(&cc->lock);
+
+	// The tick count keeps the names apart from the ones of other processes sharing the cache
+	_sntprintf(out_temp_name, MAX_PATH + MAX_KEY_NAME_LENGTH, TEXT("%s%s%llx-%llx"), cc->path, TEMPORARY_FILE_PREFIX, (unsigned long long) GetTickCount64(), (unsigned long long) store);
+
+	HANDLE hFile = CreateFile(out_temp_name, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	cached_payload_header cph = {.signature = CACHED_PAYLOAD_SIGNATURE, .crc32 = key->crc32, .compressed_size = cp->compressed_size,
+		.compression_method = cp->compression_method};
+	memcpy(cph.digest, key->digest, COMPRESSION_CACHE_DIGEST_SIZE);
+	_WriteFileAt(hFile, &cph, sizeof(cached_payload_header), 0);
+	return hFile;
+}
+
+/**
+ * Closes the specified temporary file, whose payload is complete, and moves it into place, trimming the cache if it grew too large.
+*/
+static void publish_payload(compression_cache* cc, const compression_cache_key* key, const cached_payload* cp, HANDLE hFile, LPCTSTR temp_name) {
+	_CloseHandle(hFile);
+
+	TCHAR name[MAX_PATH];
+	memcpy(name, cc->path, cc->path_length * sizeof(TCHAR));
+	set_key_name(cc, key, name + cc->path_length);
+
+	if(!MoveFileEx(temp_name, name, MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFile(temp_name);
+		return;
+	}
+
+	EnterCriticalSection(&cc->lock);
+	cc->size += sizeof(cached_payload_header) + cp->compressed_size;
+	bool must_trim = cc->size > cc->max_size && !cc->trimming;
+	if(must_trim)
+		cc->trimming = true;
+	LeaveCriticalSection(&cc->lock);
+
+	if(must_trim)
+		trim(cc);
+}
+
+
+/* Header Implementations */
+
+compression_cache* compression_cache_create(LPCTSTR path, uint64_t max_size, int level) {
+	compression_cache* cc = Calloc(1, sizeof(compression_cache));
+	cc->max_size = max_size;
+	cc->level = level;
+
+	// Leave room for the separator and the payloads' names
+	cc->path_length = _GetFullPathName(path, MAX_PATH - MAX_KEY_NAME_LENGTH - 1, cc->path, NULL);
+	if(cc->path_length >= MAX_PATH - MAX_KEY_NAME_LENGTH - 1)
+		exit_with_error("Cache directory path is too long\n");
+
+	// The directory may already exist
+	SHCreateDirectoryEx(NULL, cc->path, NULL);
+
+	if(cc->path[cc->path_length - 1] != PATH_SEPARATOR) {
+		cc->path[cc->path_length++] = PATH_SEPARATOR;
+		cc->path[cc->path_length] = TEXT('\0');
+	}
+
+	InitializeCriticalSection(&cc->lock);
+	trim(cc);
+	return cc;
+}
+
+void compression_cache_key_for_buffer(const void* data, uint64_t size, uint16_t compression_method, compression_cache_key* out_key) {
+	blake2b_state state;
+	blake2b_init(&state, COMPRESSION_CACHE_DIGEST_SIZE);
+	blake2b_update(&state, data, size);
+	blake2b_final(&state, out_key->digest);
+
+	out_key->crc32 = crc32_update(0, data, size);
+	out_key->compression_method = compression_method;
+}
+
+void compression_cache_key_for_file(LPTSTR name, uint64_t size, uint16_t compression_method, compression_cache_key* out_key) {
+	HANDLE hFile = _CreateFile(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	unsigned char* buffer = Malloc(COPY_BUFFER_SIZE);
+
+	blake2b_state state;
+	blake2b_init(&state, COMPRESSION_CACHE_DIGEST_SIZE);
+	out_key->crc32 = 0;
+	for(uint64_t pos = 0; pos < size; ) {
+		DWORD batch_size = MIN(size - pos, COPY_BUFFER_SIZE);
+		DWORD bytes_read = _ReadFileAt(hFile, buffer, batch_size, pos);
+		if(bytes_read != batch_size)
+			exit_with_error("File changed while being read\n");
+
+		blake2b_update(&state, buffer, bytes_read);
+		out_key->crc32 = crc32_update(out_key->crc32, buffer, bytes_read);
+		pos += bytes_read;
+	}
+
+	blake2b_final(&state, out_key->digest);
+	out_key->compression_method = compression_method;
+
+	Free(buffer);
+	_CloseHandle(hFile);
+}
+
+bool compression_cache_load(compression_cache* cc, const compression_cache_key* key, cached_payload* out_cp, unsigned char** out_data) {
+	HANDLE hFile = open_payload(cc, key, out_cp);
+	if(hFile == NULL)
+		return false;
+
+	*out_data = NULL;
+	if(out_cp->compressed_size > 0) {
+		*out_data = Malloc(out_cp->compressed_size);
+		DWORD bytes_read = _ReadFileAt(hFile, *out_data, out_cp->compressed_size, sizeof(cached_payload_header));
+
+		if(bytes_read != out_cp->compressed_size) {
+			Free(*out_data);
+			_CloseHandle(hFile);
+			return false;
+		}
+	}
+
+	_CloseHandle(hFile);
+	return true;
+}
+
+bool compression_cache_copy(compression_cache* cc, const compression_cache_key* key, HANDLE hDest, uint64_t dest_offset, cached_payload* out_cp) {
+	HANDLE hFile = open_payload(cc, key, out_cp);
+	if(hFile == NULL)
+		return false;
+
+	bool copied = out_cp->compressed_size == 0;
+#ifdef COPY_FILE_RANGE_SUPPORTED
+	if(!copied)
+		copied = _CopyFileRange(hFile, sizeof(cached_payload_header), hDest, dest_offset, out_cp->compressed_size);
+#endif
+
+	if(!copied) {
+		unsigned char* buffer = Malloc(COPY_BUFFER_SIZE);
+		for(uint64_t pos = 0; pos < out_cp->compressed_size; ) {
+			DWORD size = MIN(out_cp->compressed_size - pos, COPY_BUFFER_SIZE);
+			if(_ReadFileAt(hFile, buffer, size, sizeof(cached_payload_header) + pos) != size)
+				exit_with_error("Cached payload changed while being read\n");
+
+			_WriteFileAt(hDest, buffer, size, dest_offset + pos);
+			pos += size;
+		}
+		Free(buffer);
+	}
+
+	_CloseHandle(hFile);
+	return true;
+}
+
+void compression_cache_store_buffer(compression_cache* cc, const compression_cache_key* key, const cached_payload* cp, const void* data) {
+	TCHAR temp_name[MAX_PATH + MAX_KEY_NAME_LENGTH];
+	HANDLE hFile = create_payload(cc, key, cp, temp_name);
+	if(hFile == NULL)
+		return;
+
+	if(cp->compressed_size > 0)
+		_WriteFileAt(hFile, data, cp->compressed_size, sizeof(cached_payload_header));
+	publish_payload(cc, key, cp, hFile, temp_name);
+}
+
+void compression_cache_store_file(compression_cache* cc, const compression_cache_key* key, const cached_payload* cp, HANDLE hSource, uint64_t source_offset) {
+	TCHAR temp_name[MAX_PATH + MAX_KEY_NAME_LENGTH];
+	HANDLE hFile = create_payload(cc, key, cp, temp_name);
+	if(hFile == NULL)
+		return;
+
+	bool copied = cp->compressed_size == 0;
+#ifdef COPY_FILE_RANGE_SUPPORTED
+	if(!copied)
+		copied = _CopyFileRange(hSource, source_offset, hFile, sizeof(cached_payload_header), cp->compressed_size);
+#endif
+
+	if(!copied) {
+		unsigned char* buffer = Malloc(COPY_BUFFER_SIZE);
+		for(uint64_t pos = 0; pos < cp->compressed_size; ) {
+			DWORD size = MIN(cp->compressed_size - pos, COPY_BUFFER_SIZE);
+
+			// Don't cache a payload that's missing part of its data
+			if(_ReadFileAt(hSource, buffer, size, source_offset + pos) != size) {
+				Free(buffer);
+				_CloseHandle(hFile);
+				DeleteFile(temp_name);
+				return;
+			}
+
+			_WriteFileAt(hFile, buffer, size, sizeof(cached_payload_header) + pos);
+			pos += size;
+		}
+		Free(buffer);
+	}
+
+	publish_payload(cc, key, cp, hFile, temp_name);
+}
+
+void compression_cache_destroy(compression_cache* cc) {
+	DeleteCriticalSection(&cc->lock);
+	Free(cc);
+}
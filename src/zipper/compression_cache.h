@@ -0,0 +1,132 @@
+#ifndef _COMPRESSION_CACHE_H
+#define _COMPRESSION_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "../platform.h"
+#include "blake2b.h"
+
+#define COMPRESSION_CACHE_DIGEST_SIZE 	32
+
+/*
+ * On-disk cache of compressed file contents, shared by runs and by threads.
+ *
+ * Each payload is kept in its own file in the cache's directory, named after its key: a BLAKE2b digest of the
+ * uncompressed content, and the compression method and level it was compressed with. Looking a
+ * payload up is just opening its file, and payloads are stored through a temporary file that's renamed into
+ * place, so neither needs a lock and several processes can share a cache. Hits refresh their file's last write
+ * time, and once the cache outgrows its size bound the least recently used payloads are deleted.
+ *
+ * Contents that compressing didn't shrink are cached without data, as a record that they're stored instead.
+ *
+ * The digest is cryptographic, so a hit never substitutes another content's compressed data, even for contents
+ * crafted to collide. It's kept in the payload's header too and checked on every hit.
+ */
+
+typedef struct {
+	unsigned char digest[COMPRESSION_CACHE_DIGEST_SIZE];
+	uint32_t crc32;
+	uint16_t compression_method; 	// the one asked for, the payload may be stored instead
+} compression_cache_key;
+
+typedef struct {
+	uint16_t compression_method; 	// NO_COMPRESSION if the content is stored instead, then there's no data
+	uint64_t compressed_size; 		// of the data
+} cached_payload;
+
+typedef struct {
+	TCHAR path[MAX_PATH]; 		// ends with a separator
+	size_t path_length;
+	int level;
+
+	uint64_t size, max_size; 	// of the payload files, as far as this process knows
+	uint64_t num_stores; 		// names the temporary files
+	bool trimming; 				// whether a thread is trimming the cache
+
+	CRITICAL_SECTION lock;
+} compression_cache;
+
+/**
+ * Opens the cache in the specified directory, creating the directory if it doesn't exist, and trims it to its size bound.
+ *
+ * @param path the path to the cache's directory
+ * @param max_size the maximum total size of the cached payloads
+ * @param level the compression level that the payloads are compressed with, part of their keys
+ * @return a pointer to the cache
+*/
+compression_cache* compression_cache_create(LPCTSTR path, uint64_t max_size, int level);
+
+/**
+ * Computes the key of the specified data, compressed with the specified method.
+ *
+ * @param data the uncompressed data
+ * @param size the size of the data
+ * @param compression_method the compression method
+ * @param out_key a pointer to a variable to receive the key
+*/
+void compression_cache_key_for_buffer(const void* data, uint64_t size, uint16_t compression_method, compression_cache_key* out_key);
+
+/**
+ * Computes the key of the specified file's content, compressed with the specified method, reading the whole file.
+ *
+ * @param name the path to the file
+ * @param size the size of the file
+ * @param compression_method the compression method
+ * @param out_key a pointer to a variable to receive the key
+*/
+void compression_cache_key_for_file(LPTSTR name, uint64_t size, uint16_t compression_method, compression_cache_key* out_key);
+
+/**
+ * Reads the payload with the specified key into memory, if it's cached. It may be called concurrently.
+ *
+ * @param cc the cache
+ * @param key the payload's key
+ * @param out_cp a pointer to a variable to receive the payload's compression method and size
+ * @param out_data a pointer to a variable to receive the payload's data, to be freed by the caller, or NULL if it has none
+ * @return whether the payload was cached
+*/
+bool compression_cache_load(compression_cache* cc, const compression_cache_key* key, cached_payload* out_cp, unsigned char** out_data);
+
+/**
+ * Copies the payload with the specified key to the specified file, if it's cached, copying nothing if it has no data.
+ * It may be called concurrently.
+ *
+ * @param cc the cache
+ * @param key the payload's key
+ * @param hDest the file to copy the payload to, written sequentially from the offset if it isn't a disk file
+ * @param dest_offset the offset in the file to copy the payload to
+ * @param out_cp a pointer to a variable to receive the payload's compression method and size
+ * @return whether the payload was cached and copied
+*/
+bool compression_cache_copy(compression_cache* cc, const compression_cache_key* key, HANDLE hDest, uint64_t dest_offset, cached_payload* out_cp);
+
+/**
+ * Stores the specified payload in memory under the specified key. It may be called concurrently.
+ *
+ * @param cc the cache
+ * @param key the payload's key
+ * @param cp the payload's compression method and size
+ * @param data the payload's data, unused if it has none
+*/
+void compression_cache_store_buffer(compression_cache* cc, const compression_cache_key* key, const cached_payload* cp, const void* data);
+
+/**
+ * Stores the payload at the specified offset in the specified file under the specified key. It may be called concurrently.
+ *
+ * @param cc the cache
+ * @param key the payload's key
+ * @param cp the payload's compression method and size
+ * @param hSource the disk file the payload is in, which must be open for reading
+ * @param source_offset the offset of the payload in the file
+*/
+void compression_cache_store_file(compression_cache* cc, const compression_cache_key* key, const cached_payload* cp, HANDLE hSource, uint64_t source_offset);
+
+/**
+ * Closes the specified cache, whose payloads stay on disk.
+ *
+ * @param cc the cache to close
+*/
+void compression_cache_destroy(compression_cache* cc);
+
+#endif
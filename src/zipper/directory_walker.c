@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "directory_walker.h"
+#include "../wrapper_functions.h"
+
+#define DIRECTORY_CHILDREN_INITIAL_CAPACITY 	16
+#define DIRECTORY_NAMES_INITIAL_CAPACITY 		256
+#define MAX_LISTINGS 							1024
+
+
+/* Helper Functions */
+
+static int compare_children(const void* a, const void* b) {
+	return _tcscmp(((const directory_child*) a)->name, ((const directory_child*) b)->name);
+}
+
+/**
+ * Reads the children of the listing's directory, without their names, which are appended to the listing's
+ * name pool instead. Returns the offsets of their names in the pool.
+*/
+static size_t* read_children(directory_listing* dl) {
+	size_t path_length = _tcslen(dl->path);
+
+	// Append "*" to path to get all files in directory
+	TCHAR pattern[path_length + 2];
+	memcpy(pattern, dl->path, path_length * sizeof(TCHAR));
+	memcpy(pattern + path_length, TEXT("*"), 2 * sizeof(TCHAR));
+
+	size_t capacity = DIRECTORY_CHILDREN_INITIAL_CAPACITY, names_capacity = DIRECTORY_NAMES_INITIAL_CAPACITY, names_length = 0;
+	dl->children = Malloc(capacity * sizeof(directory_child));
+	dl->names = Malloc(names_capacity * sizeof(TCHAR));
+	size_t* name_offsets = Malloc(capacity * sizeof(size_t));
+
+	WIN32_FIND_DATA fdFile;
+	HANDLE hFind = _FindFirstFile(pattern, &fdFile);
+
+	do {
+		// Skip "." and "..", which aren't guaranteed to be the first finds
+		if(!_tcscmp(fdFile.cFileName, TEXT(".")) || !_tcscmp(fdFile.cFileName, TEXT("..")))
+			continue;
+
+		if(dl->num_children == capacity) {
+			capacity *= 2;
+			dl->children = Realloc(dl->children, capacity * sizeof(directory_child));
+			name_offsets = Realloc(name_offsets, capacity * sizeof(size_t));
+		}
+
+		size_t name_length = _tcslen(fdFile.cFileName);
+		if(names_length + name_length + 1 > names_capacity) {
+			while(names_length + name_length + 1 > names_capacity)
+				names_capacity *= 2;
+			dl->names = Realloc(dl->names, names_capacity * sizeof(TCHAR));
+		}
+
+		memcpy(dl->names + names_length, fdFile.cFileName, (name_length + 1) * sizeof(TCHAR));
+		name_offsets[dl->num_children] = names_length;
+		names_length += name_length + 1;
+
+		directory_child* child = dl->children + dl->num_children++;
+		child->attributes = fdFile.dwFileAttributes;
+		child->size = (uint64_t) fdFile.nFileSizeHigh << 32 | fdFile.nFileSizeLow;
+		child->last_write_time = fdFile.ftLastWriteTime;
+		child->listing = NULL;
+	} while(_FindNextFile(hFind, &fdFile));
+
+	_FindClose(hFind);
+	return name_offsets;
+}
+
+/**
+ * Counts a new listing if there's room for it within the bound and returns whether there was.
+*/
+static bool reserve_listing(directory_walker* dw) {
+	EnterCriticalSection(&dw->lock);
+	bool reserved = dw->num_listings < MAX_LISTINGS;
+	if(reserved)
+		dw->num_listings++;
+	LeaveCriticalSection(&dw->lock);
+
+	return reserved;
+}
+
+static directory_listing* start_listing(directory_walker* dw, LPCTSTR path);
+
+static void list_directory_task(void* data) {
+	directory_listing* dl = (directory_listing*) data;
+
+	size_t* name_offsets = read_children(dl);
+
+	// The name pool doesn't move anymore
+	for(size_t i = 0; i < dl->num_children; i++)
+		dl->children[i].name = dl->names + name_offsets[i];
+	Free(name_offsets);
+
+	qsort(dl->children, dl->num_children, sizeof(directory_child), compare_children);
+
+	size_t path_length = _tcslen(dl->path);
+
+	for(size_t i = 0; i < dl->num_children; i++) {
+		directory_child* child = dl->children + i;
+		size_t name_length = _tcslen(child->name);
+
+		if(!(child->attributes & FILE_ATTRIBUTE_DIRECTORY) || !reserve_listing(dl->dw))
+			continue;
+
+		// Copy path and child name into buffer, followed by a separator
+		TCHAR child_path[path_length + name_length + 2];
+		memcpy(child_path, dl->path, path_length * sizeof(TCHAR));
+		memcpy(child_path + path_length, child->name, name_length * sizeof(TCHAR));
+		child_path[path_length + name_length] = PATH_SEPARATOR;
+		child_path[path_length + name_length + 1] = TEXT('\0');
+
+		child->listing = start_listing(dl->dw, child_path);
+	}
+}
+
+
+static directory_listing* start_listing(directory_walker* dw, LPCTSTR path) {
+	size_t path_length = _tcslen(path);
+
+	directory_listing* dl = Calloc(1, sizeof(directory_listing));
+	dl->dw = dw;
+	dl->path = Malloc((path_length + 1) * sizeof(TCHAR));
+	memcpy(dl->path, path, (path_length + 1) * sizeof(TCHAR));
+
+	thread_pool_submit(&dl->wg, list_directory_task, dl);
+	return dl;
+}
+
+
+/* Header Implementations */
+
+directory_walker* directory_walker_create() {
+	directory_walker* dw = Calloc(1, sizeof(directory_walker));
+	InitializeCriticalSection(&dw->lock);
+	return dw;
+}
+
+directory_listing* directory_walker_start(directory_walker* dw, LPCTSTR path) {
+	// Listings that are asked for are always started, so the bound is never waited on
+	EnterCriticalSection(&dw->lock);
+	dw->num_listings++;
+	LeaveCriticalSection(&dw->lock);
+
+	return start_listing(dw, path);
+}
+
+void directory_walker_wait(directory_listing* dl) {
+	wait_group_wait(&dl->wg);
+}
+
+directory_listing* directory_walker_child_listing(directory_listing* dl, size_t child) {
+	directory_child* dc = dl->children + child;
+	if(dc->listing != NULL)
+		return dc->listing;
+
+	size_t path_length = _tcslen(dl->path), name_length = _tcslen(dc->name);
+
+	TCHAR child_path[path_length + name_length + 2];
+	memcpy(child_path, dl->path, path_length * sizeof(TCHAR));
+	memcpy(child_path + path_length, dc->name, name_length * sizeof(TCHAR));
+	child_path[path_length + name_length] = PATH_SEPARATOR;
+	child_path[path_length + name_length + 1] = TEXT('\0');
+
+	return directory_walker_start(dl->dw, child_path);
+}
+
+void directory_listing_destroy(directory_listing* dl) {
+	EnterCriticalSection(&dl->dw->lock);
+	dl->dw->num_listings--;
+	LeaveCriticalSection(&dl->dw->lock);
+
+	Free(dl->children);
+	Free(dl->names);
+	Free(dl->path);
+	Free(dl);
+}
+
+void directory_walker_destroy(directory_walker* dw) {
+	DeleteCriticalSection(&dw->lock);
+	Free(dw);
+}
@@ -0,0 +1,94 @@
+#ifndef _DIRECTORY_WALKER_H
+#define _DIRECTORY_WALKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../platform.h"
+#include "../compression/thread_pool.h"
+
+/*
+ * Parallel directory tree walker.
+ *
+ * Each directory is listed by its own task on the thread pool, which takes the size and last write
+ * time of its children from the listing itself and queues a task for each subdirectory, so idle
+ * threads pick up whichever directories are pending. Children are sorted by name, which makes the
+ * order of a tree's entries independent of the file system and of the timing of the tasks.
+ *
+ * The number of listings held at once is bounded, past it subdirectories are only listed once
+ * they're asked for, so the walker can't get arbitrarily far ahead of whoever reads the listings.
+ */
+
+typedef struct directory_listing directory_listing;
+
+typedef struct {
+	CRITICAL_SECTION lock;
+	size_t num_listings; 			// started and not yet destroyed
+} directory_walker;
+
+typedef struct {
+	LPTSTR name; 					// within the directory
+	DWORD attributes;
+	uint64_t size;
+	FILETIME last_write_time;
+	directory_listing* listing; 	// NULL for files and subdirectories that weren't listed ahead
+} directory_child;
+
+struct directory_listing {
+	directory_walker* dw;
+	LPTSTR path; 					// ends with a separator
+	directory_child* children; 		// sorted by name
+	size_t num_children;
+	TCHAR* names; 					// every child's name
+	wait_group wg; 					// done once the children are listed
+};
+
+/**
+ * Creates and returns a pointer to a new directory walker.
+ *
+ * @return a pointer to a new directory walker
+*/
+directory_walker* directory_walker_create();
+
+/**
+ * Starts listing the directory at the specified path and, as far as the bound allows, its
+ * subdirectories on the thread pool, and returns its listing, which must be waited for before it's read.
+ *
+ * @param dw the directory walker
+ * @param path the path to the directory, which must end with a separator
+ * @return the directory's listing
+*/
+directory_listing* directory_walker_start(directory_walker* dw, LPCTSTR path);
+
+/**
+ * Waits until the specified directory's children are listed. Its subdirectories' listings may
+ * still be in progress.
+ *
+ * @param dl the directory's listing
+*/
+void directory_walker_wait(directory_listing* dl);
+
+/**
+ * Returns the listing of the specified child directory of the specified listing, which must
+ * have been waited for, starting it if it wasn't listed ahead.
+ *
+ * @param dl the parent directory's listing
+ * @param child the index of the child directory
+ * @return the child directory's listing, which must be waited for before it's read
+*/
+directory_listing* directory_walker_child_listing(directory_listing* dl, size_t child);
+
+/**
+ * Frees the specified directory listing, but not its subdirectories' listings nor its children's files.
+ *
+ * @param dl the directory listing to free
+*/
+void directory_listing_destroy(directory_listing* dl);
+
+/**
+ * Destroys the specified directory walker, whose listings must all be destroyed.
+ *
+ * @param dw the directory walker to destroy
+*/
+void directory_walker_destroy(directory_walker* dw);
+
+#endif
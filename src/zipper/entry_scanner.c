@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include "../platform.h"
+#include "entry_scanner.h"
+#include "../compression/compression.h"
+#include "../wrapper_functions.h"
+
+#define SCANNER_QUEUE_CAPACITY 	4096
+
+
+/* Helper Functions */
+
+#ifdef UNICODE
+static void replace_char(char* str, char find, char replace) {
+	char* current_pos = strchr(str, find);
+	while(current_pos) {
+		*current_pos = replace;
+		current_pos = strchr(current_pos, find);
+	}
+}
+#endif
+
+static void set_entry_name(entry_scanner* es, pending_entry* pe, LPTSTR path) {
+	// Cut out preceding dot and slash if in path
+	if(path[0] == TEXT('.') && path[1] == PATH_SEPARATOR)
+		path += 2;
+
+	unsigned path_length = _tcslen(path);
+	bool needs_trailing_slash = (pe->windows_file_attributes & FILE_ATTRIBUTE_DIRECTORY) && path[path_length - 1] != PATH_SEPARATOR;
+
+	// Copy path to name
+	unsigned name_length = path_length + needs_trailing_slash;
+	LPTSTR name = arena_alloc(es->names_arena, (name_length + 1) * sizeof(TCHAR));
+	memcpy(name, path, (path_length + 1) * sizeof(TCHAR));
+
+	// Add a trailing slash if directory is missing one
+	if(needs_trailing_slash) {
+		name[name_length - 1] = PATH_SEPARATOR;
+		name[name_length] = TEXT('\0');
+	}
+
+	pe->name = name;
+
+#ifdef UNICODE
+	// Convert name to UTF-8
+	int utf8_name_length = _WideCharToMultiByte(CP_UTF8, 0, name, -1, NULL, 0, NULL, NULL) - 1;
+	char* utf8_name = arena_alloc(es->names_arena, utf8_name_length + 1);
+	_WideCharToMultiByte(CP_UTF8, 0, name, -1, utf8_name, utf8_name_length + 1, NULL, NULL);
+
+	// Replace backward slashes with forward slashes in UTF-8 name (the one written to the ZIP file)
+	replace_char(utf8_name, '\\', '/');
+
+	pe->utf8_name = utf8_name;
+	pe->utf8_name_length = utf8_name_length;
+#else
+	// Native names are already UTF-8 with forward slashes and can be written to the ZIP file as they are
+	pe->utf8_name = name;
+	pe->utf8_name_length = name_length;
+#endif
+}
+
+static void set_entry_mod_time(pending_entry* pe, const FILETIME* last_write_time) {
+	SYSTEMTIME lastModUTCTime, lastModLocalTime;
+
+	// Get file last mod time
+	_FileTimeToSystemTime(last_write_time, &lastModUTCTime);
+	_SystemTimeToTzSpecificLocalTime(NULL, &lastModUTCTime, &lastModLocalTime);
+
+	pe->mod_time = lastModLocalTime.wHour << 11 | lastModLocalTime.wMinute << 5 | lastModLocalTime.wSecond / 2;
+	pe->mod_date = (lastModLocalTime.wYear - 1980) << 9 | lastModLocalTime.wMonth << 5 | lastModLocalTime.wDay;
+}
+
+/**
+ * Hands out an entry for the file or directory at the specified path, with the specified metadata,
+ * and returns its name, which ends with a separator for directories.
+*/
+static LPTSTR add_entry(entry_scanner* es, LPTSTR path, DWORD attributes, uint64_t size, const FILETIME* last_write_time) {
+	fprintf(zipper_log, "Adding " TSTR_FMT "\n", path);
+
+	pending_entry pe = {0};
+	pe.windows_file_attributes = attributes;
+	pe.uncompressed_size = size;
+	set_entry_name(es, &pe, path);
+
+	if(!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+		set_entry_mod_time(&pe, last_write_time);
+
+	// Directories and empty files are always stored, automatic compression is only settled once the file is compressed
+	pe.compression_method = size == 0 ? NO_COMPRESSION : es->compression_method;
+
+	ring_queue_push(es->queue, &pe);
+	return pe.name;
+}
+
+/**
+ * Hands out the entries of the specified directory's children, in order, each followed by its own descendants,
+ * as their listings complete. Frees the listings.
+*/
+static void add_listing_entries(entry_scanner* es, directory_listing* dl) {
+	directory_walker_wait(dl);
+
+	size_t path_length = _tcslen(dl->path);
+
+	for(size_t i = 0; i < dl->num_children; i++) {
+		directory_child* child = dl->children + i;
+		size_t name_length = _tcslen(child->name);
+
+		// Copy path and child name into buffer
+		TCHAR child_path[path_length + name_length + 1];
+		memcpy(child_path, dl->path, path_length * sizeof(TCHAR));
+		memcpy(child_path + path_length, child->name, (name_length + 1) * sizeof(TCHAR));
+
+		add_entry(es, child_path, child->attributes, child->size, &child->last_write_time);
+
+		if(child->attributes & FILE_ATTRIBUTE_DIRECTORY)
+			add_listing_entries(es, directory_walker_child_listing(dl, i));
+	}
+
+	directory_listing_destroy(dl);
+}
+
+static void add_path_entries(entry_scanner* es, LPTSTR path) {
+	DWORD attributes = _GetFileAttributes(path);
+
+	// Files given directly are only opened to get their metadata, which directory listings already have
+	if(!(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		HANDLE hFile = _CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		LARGE_INTEGER fileSize;
+		FILETIME lastWriteTime;
+		_GetFileSizeEx(hFile, &fileSize);
+		_GetFileTime(hFile, NULL, NULL, &lastWriteTime);
+		_CloseHandle(hFile);
+
+		add_entry(es, path, attributes, fileSize.QuadPart, &lastWriteTime);
+		return;
+	}
+
+	// The directory's name ends with a separator, as the walker needs
+	LPTSTR name = add_entry(es, path, attributes, 0, NULL);
+	add_listing_entries(es, directory_walker_start(es->dw, name));
+}
+
+static DWORD WINAPI scanner_thread(void* data) {
+	entry_scanner* es = (entry_scanner*) data;
+
+	for(size_t i = 0; i < es->num_paths; i++)
+		add_path_entries(es, es->paths[i]);
+
+	ring_queue_close(es->queue);
+	return 0;
+}
+
+
+/* Header Implementations */
+
+entry_scanner* entry_scanner_start(LPTSTR* paths, size_t num_paths, unsigned compression_method) {
+	entry_scanner* es = Calloc(1, sizeof(entry_scanner));
+	es->paths = paths;
+	es->num_paths = num_paths;
+	es->compression_method = compression_method;
+
+	es->queue = ring_queue_create(SCANNER_QUEUE_CAPACITY, sizeof(pending_entry));
+	es->names_arena = arena_create();
+	es->dw = directory_walker_create();
+
+	es->hThread = _CreateThread(NULL, 0, scanner_thread, es, 0, NULL);
+	return es;
+}
+
+bool entry_scanner_next(entry_scanner* es, pending_entry* out_pe, bool wait) {
+	return ring_queue_pop(es->queue, out_pe, wait);
+}
+
+void entry_scanner_destroy(entry_scanner* es) {
+	_WaitForMultipleObjects(1, &es->hThread, TRUE, INFINITE);
+	_CloseHandle(es->hThread);
+
+	directory_walker_destroy(es->dw);
+	arena_destroy(es->names_arena);
+	ring_queue_destroy(es->queue);
+	Free(es);
+}
@@ -0,0 +1,58 @@
+#ifndef _ENTRY_SCANNER_H
+#define _ENTRY_SCANNER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "../platform.h"
+#include "entry_table.h"
+#include "directory_walker.h"
+#include "ring_queue.h"
+#include "arena.h"
+
+/*
+ * First stage of the zipper's pipeline, which turns the paths to add into entries in zip order.
+ *
+ * The scanner runs on its own thread and hands the entries out through a bounded queue as soon as
+ * they're found, so writing starts right away and the scanner waits whenever the writer falls behind.
+ * Directories are walked with the directory walker, each followed by its descendants.
+ */
+
+typedef struct {
+	LPTSTR* paths;
+	size_t num_paths;
+	unsigned compression_method;
+
+	ring_queue* queue; 		// of pending entries
+	arena* names_arena; 	// only allocated from by the scanner's thread
+	directory_walker* dw;
+	HANDLE hThread;
+} entry_scanner;
+
+/**
+ * Starts scanning the specified paths on a new thread and returns the scanner.
+ *
+ * @param paths the relative paths to the files and directories to add
+ * @param num_paths the number of paths
+ * @param compression_method the compression method to use, optionally ORed with AUTO_COMPRESSION
+ * @return the scanner
+*/
+entry_scanner* entry_scanner_start(LPTSTR* paths, size_t num_paths, unsigned compression_method);
+
+/**
+ * Takes the next entry found by the specified scanner. If there's none yet, waits for it if specified.
+ *
+ * @param es the scanner
+ * @param out_pe where to copy the entry to
+ * @param wait whether to wait for the next entry to be found
+ * @return true if an entry was taken, false if there are no more entries or none was found yet and it wasn't waited for
+*/
+bool entry_scanner_next(entry_scanner* es, pending_entry* out_pe, bool wait);
+
+/**
+ * Destroys the specified scanner, which must have run out of entries, freeing its entries' names.
+ *
+ * @param es the scanner to destroy
+*/
+void entry_scanner_destroy(entry_scanner* es);
+
+#endif
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include "../platform.h"
+#include "entry_table.h"
+#include "../compression/compression.h"
+#include "../compression/crc32.h"
+#include "../wrapper_functions.h"
+
+#define ENTRY_TABLE_INITIAL_CAPACITY 	64
+
+#define GROW_ARRAY(array, capacity) 	((array) = Realloc((array), (capacity) * sizeof(*(array))))
+
+typedef compression_result (*file_compression_function)(LPTSTR origin_name, HANDLE hDest, uint64_t dest_offset, uint64_t file_size);
+typedef compression_result (*buffer_compression_function)(const void* data, size_t size, unsigned char** out_data);
+
+FILE* zipper_log;
+
+
+/* Helper Functions */
+
+/**
+ * Appends an entry to the table and returns its index. Its fields are uninitialized.
+*/
+static size_t add_entry(entry_table* et) {
+	if(et->num_entries == et->capacity) {
+		et->capacity = et->capacity == 0 ? ENTRY_TABLE_INITIAL_CAPACITY : et->capacity * 2;
+
+		GROW_ARRAY(et->utf8_names, et->capacity);
+		GROW_ARRAY(et->utf8_name_lengths, et->capacity);
+		GROW_ARRAY(et->uncompressed_sizes, et->capacity);
+		GROW_ARRAY(et->compressed_sizes, et->capacity);
+		GROW_ARRAY(et->local_header_offsets, et->capacity);
+		GROW_ARRAY(et->crc32s, et->capacity);
+		GROW_ARRAY(et->compression_methods, et->capacity);
+		GROW_ARRAY(et->mod_times, et->capacity);
+		GROW_ARRAY(et->mod_dates, et->capacity);
+		GROW_ARRAY(et->windows_file_attributes, et->capacity);
+		GROW_ARRAY(et->has_data_descriptors, et->capacity);
+	}
+
+	return et->num_entries++;
+}
+
+static file_compression_function file_compression_function_for(uint16_t compression_method) {
+	switch(compression_method) {
+		case(DEFLATE): return deflate_compress;
+#ifdef ZSTANDARD_SUPPORTED
+		case(ZSTANDARD): return zstd_compress;
+#endif
+		default: return no_compression_compress;
+	}
+}
+
+static buffer_compression_function buffer_compression_function_for(uint16_t compression_method) {
+	switch(compression_method) {
+		case(DEFLATE): return deflate_compress_buffer;
+#ifdef ZSTANDARD_SUPPORTED
+		case(ZSTANDARD): return zstd_compress_buffer;
+#endif
+		default: return NULL;
+	}
+}
+
+
+/* Header Implementations */
+
+entry_table* entry_table_create() {
+	return Calloc(1, sizeof(entry_table));
+}
+
+size_t entry_table_append(entry_table* et, const pending_entry* pe) {
+	size_t entry = add_entry(et);
+
+	et->utf8_names[entry] = pe->utf8_name;
+	et->utf8_name_lengths[entry] = pe->utf8_name_length;
+	et->uncompressed_sizes[entry] = pe->uncompressed_size;
+	et->compressed_sizes[entry] = pe->compressed_size;
+	et->local_header_offsets[entry] = 0;
+	et->crc32s[entry] = pe->crc32;
+	et->compression_methods[entry] = pe->compression_method;
+	et->mod_times[entry] = pe->mod_time;
+	et->mod_dates[entry] = pe->mod_date;
+	et->windows_file_attributes[entry] = pe->windows_file_attributes;
+	et->has_data_descriptors[entry] = false;
+
+	return entry;
+}
+
+void entry_table_destroy(entry_table* et) {
+	Free(et->utf8_names);
+	Free(et->utf8_name_lengths);
+	Free(et->uncompressed_sizes);
+	Free(et->compressed_sizes);
+	Free(et->local_header_offsets);
+	Free(et->crc32s);
+	Free(et->compression_methods);
+	Free(et->mod_times);
+	Free(et->mod_dates);
+	Free(et->windows_file_attributes);
+	Free(et->has_data_descriptors);
+	Free(et);
+}
+
+void entry_select_compression(entry_table* et, size_t entry, LPTSTR name) {
+	if(et->compression_methods[entry] & AUTO_COMPRESSION)
+		et->compression_methods[entry] = auto_compression_select(name, et->uncompressed_sizes[entry], et->compression_methods[entry] & ~AUTO_COMPRESSION);
+}
+
+void entry_compress_and_write(entry_table* et, size_t entry, LPTSTR name, HANDLE hDest, uint64_t dest_offset, compression_cache* cc) {
+	uint64_t uncompressed_size = et->uncompressed_sizes[entry];
+	if(uncompressed_size == 0)
+		return;
+
+	entry_select_compression(et, entry, name);
+
+	// Copy the compressed data from the cache if the same content was compressed the same way before. With a data
+	// descriptor the header already names the compression method, so the file is compressed anyway if it was stored
+	compression_cache_key key;
+	cached_payload cp;
+	bool cache_miss = false;
+
+	if(cc != NULL && et->compression_methods[entry] != NO_COMPRESSION) {
+		compression_cache_key_for_file(name, uncompressed_size, et->compression_methods[entry], &key);
+		cache_miss = !compression_cache_copy(cc, &key, hDest, dest_offset, &cp);
+
+		if(!cache_miss && (cp.compression_method != NO_COMPRESSION || !et->has_data_descriptors[entry])) {
+			// The key was computed from an earlier read of the file, which a stored copy must still match
+			if(cp.compression_method == NO_COMPRESSION && no_compression_compress(name, hDest, dest_offset, uncompressed_size).crc32 != key.crc32)
+				exit_with_error("File changed while being read\n");
+
+			et->compression_methods[entry] = cp.compression_method;
+			et->compressed_sizes[entry] = cp.compression_method == NO_COMPRESSION ? uncompressed_size : cp.compressed_size;
+			et->crc32s[entry] = key.crc32;
+			return;
+		}
+	}
+
+	compression_result cr = file_compression_function_for(et->compression_methods[entry])(name, hDest, dest_offset, uncompressed_size);
+
+	// Store the file instead if compressing it didn't make it smaller, overwriting the compressed data
+	if(et->compression_methods[entry] != NO_COMPRESSION && cr.destination_size >= uncompressed_size && !et->has_data_descriptors[entry]) {
+		et->compression_methods[entry] = NO_COMPRESSION;
+		cr = no_compression_compress(name, hDest, dest_offset, uncompressed_size);
+	}
+
+	et->compressed_sizes[entry] = cr.destination_size;
+	et->crc32s[entry] = cr.crc32;
+
+	// The data was compressed from another read of the file than its key, it mustn't be cached under the wrong content
+	if(cache_miss && cr.crc32 != key.crc32)
+		exit_with_error("File changed while being read\n");
+
+	// Cache the compressed data, which can only be read back from disk files
+	if(cache_miss && _GetFileType(hDest) == FILE_TYPE_DISK) {
+		cp.compression_method = et->compression_methods[entry];
+		cp.compressed_size = cp.compression_method == NO_COMPRESSION ? 0 : cr.destination_size;
+		compression_cache_store_file(cc, &key, &cp, hDest, dest_offset);
+	}
+}
+
+unsigned char* pending_entry_compress_to_buffer(pending_entry* pe, handle_cache* hc, compression_cache* cc) {
+	unsigned char* data = Malloc(pe->uncompressed_size);
+
+	HANDLE hFile = handle_cache_open(hc, pe->name);
+	DWORD bytes_read = _ReadFileAt(hFile, data, pe->uncompressed_size, 0);
+	handle_cache_release(hc, hFile);
+
+	// The file shrank since it was scanned, don't archive whatever the rest of the buffer holds
+	if(bytes_read != pe->uncompressed_size)
+		exit_with_error("File changed while being read\n");
+
+	if(pe->compression_method & AUTO_COMPRESSION)
+		pe->compression_method = auto_compression_select_buffer(pe->name, data, pe->uncompressed_size, pe->compression_method & ~AUTO_COMPRESSION);
+
+	buffer_compression_function compress = buffer_compression_function_for(pe->compression_method);
+	if(compress != NULL) {
+		compression_cache_key key;
+		cached_payload cp;
+		unsigned char* compressed_data;
+
+		// Take the compressed data from the cache if the same content was compressed the same way before
+		if(cc != NULL) {
+			compression_cache_key_for_buffer(data, pe->uncompressed_size, pe->compression_method, &key);
+
+			if(compression_cache_load(cc, &key, &cp, &compressed_data)) {
+				pe->crc32 = key.crc32;
+				pe->compression_method = cp.compression_method;
+
+				if(cp.compression_method != NO_COMPRESSION) {
+					Free(data);
+					pe->compressed_size = cp.compressed_size;
+					return compressed_data;
+				}
+
+				pe->compressed_size = pe->uncompressed_size;
+				return data;
+			}
+		}
+
+		compression_result cr = compress(data, pe->uncompressed_size, &compressed_data);
+		cp.compression_method = cr.destination_size < pe->uncompressed_size ? pe->compression_method : NO_COMPRESSION;
+		cp.compressed_size = cp.compression_method == NO_COMPRESSION ? 0 : cr.destination_size;
+		if(cc != NULL)
+			compression_cache_store_buffer(cc, &key, &cp, compressed_data);
+
+		if(cr.destination_size < pe->uncompressed_size) {
+			Free(data);
+			pe->compressed_size = cr.destination_size;
+			pe->crc32 = cr.crc32;
+			return compressed_data;
+		}
+
+		// Store the file instead if compressing it didn't make it smaller
+		Free(compressed_data);
+		pe->compression_method = NO_COMPRESSION;
+	}
+
+	pe->compressed_size = pe->uncompressed_size;
+	pe->crc32 = crc32_update(0, data, pe->uncompressed_size);
+	return data;
+}
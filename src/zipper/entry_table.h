@@ -0,0 +1,120 @@
+#ifndef _ENTRY_TABLE_H
+#define _ENTRY_TABLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "../platform.h"
+#include "../zip.h"
+#include "../compression/compression.h"
+#include "handle_cache.h"
+#include "compression_cache.h"
+
+/*
+ * Table of the entries written to the zip, in zip order, kept for the central directory.
+ *
+ * The table is a struct of arrays, indexed by entry, so each field is stored contiguously and
+ * an entry takes a few dozen bytes plus its name. It's only accessed by the writer, entries
+ * are added as they're written.
+ */
+
+// Where progress messages are printed, stderr when the zip is written to stdout
+extern FILE* zipper_log;
+
+/*
+ * An entry on its way from the scanner to the writer, which adds it to the table. Its names are
+ * allocated by the scanner and live as long as it does. Its file isn't open, it's only opened when
+ * it's compressed.
+ */
+typedef struct {
+	LPTSTR name; 						// native path, directories end with a separator
+	char* utf8_name; 					// the name written to the zip, the native name itself unless UNICODE
+	uint16_t utf8_name_length;
+	uint8_t windows_file_attributes;
+	uint16_t compression_method; 		// ORed with AUTO_COMPRESSION until it's compressed
+	uint16_t mod_time, mod_date;
+	uint64_t uncompressed_size;
+	uint64_t compressed_size; 			// set once it's compressed
+	uint32_t crc32; 					// set once it's compressed
+} pending_entry;
+
+typedef struct {
+	size_t num_entries, capacity;
+
+	char** utf8_names;
+	uint16_t* utf8_name_lengths;
+	uint64_t* uncompressed_sizes;
+	uint64_t* compressed_sizes;
+	uint64_t* local_header_offsets;
+	uint32_t* crc32s;
+	uint16_t* compression_methods;
+	uint16_t* mod_times;
+	uint16_t* mod_dates;
+	uint8_t* windows_file_attributes;
+	bool* has_data_descriptors;
+} entry_table;
+
+/**
+ * Creates and returns a pointer to a new, empty entry table.
+ *
+ * @return a pointer to a new entry table
+*/
+entry_table* entry_table_create();
+
+/**
+ * Appends the specified entry to the specified entry table and returns its index. Its local header
+ * offset is 0 and it has no data descriptor until they're set.
+ *
+ * @param et the entry table to add the entry to
+ * @param pe the entry to add, whose names must outlive the table
+ * @return the index of the added entry
+*/
+size_t entry_table_append(entry_table* et, const pending_entry* pe);
+
+/**
+ * Destroys the specified entry table, freeing its allocated memory.
+ *
+ * @param et the entry table to destroy
+*/
+void entry_table_destroy(entry_table* et);
+
+/**
+ * Settles the specified entry's compression method if it's ORed with AUTO_COMPRESSION, sampling its file.
+ * It must be done before its header is written.
+ *
+ * @param et the entry table
+ * @param entry the index of the entry
+ * @param name the path to the entry's file
+*/
+void entry_select_compression(entry_table* et, size_t entry, LPTSTR name);
+
+/**
+ * Compresses and writes the specified entry's file to the destination file, setting its compressed size and CRC32.
+ * Its compression method is settled first if it's automatic. Unless its header was already written (it has a data
+ * descriptor), it's stored instead if compressing it didn't make it smaller.
+ * The compressed data is taken from the compression cache if it's there, and added to it otherwise.
+ *
+ * @param et the entry table
+ * @param entry the index of the entry to compress
+ * @param name the path to the entry's file
+ * @param hDest the file to write the compressed data to
+ * @param dest_offset the offset of the file to write the compressed data to
+ * @param cc the compression cache, or NULL if there's none
+*/
+void entry_compress_and_write(entry_table* et, size_t entry, LPTSTR name, HANDLE hDest, uint64_t dest_offset, compression_cache* cc);
+
+/**
+ * Compresses the specified entry's file into memory, setting its compressed size, CRC32 and, if it's automatic or
+ * stored instead, compression method, and returns the compressed data. Meant for files small enough to be held in
+ * memory, it may be called concurrently for different entries. The compressed data is taken from the compression
+ * cache if it's there, and added to it otherwise.
+ *
+ * @param pe the entry to compress
+ * @param hc the handle cache to open the file through
+ * @param cc the compression cache, or NULL if there's none
+ * @return the compressed data, to be freed by the caller
+*/
+unsigned char* pending_entry_compress_to_buffer(pending_entry* pe, handle_cache* hc, compression_cache* cc);
+
+#endif
@@ -0,0 +1,105 @@
+#include <stdbool.h>
+#include "handle_cache.h"
+#include "../wrapper_functions.h"
+
+
+/* Helper Functions */
+
+/**
+ * Returns the cached handle to the file with the specified name, or NULL if there is none.
+ * Must be called with the cache's lock held.
+*/
+static cached_handle* find_handle(handle_cache* hc, LPCTSTR name) {
+	for(size_t i = 0; i < hc->num_handles; i++)
+		if(!_tcscmp(hc->handles[i].name, name))
+			return hc->handles + i;
+
+	return NULL;
+}
+
+/**
+ * Returns a free slot for a new handle, closing the least recently used handle that isn't in use
+ * if the cache is full, or NULL if every handle is in use. Must be called with the cache's lock held.
+*/
+static cached_handle* free_slot(handle_cache* hc) {
+	if(hc->num_handles < hc->capacity)
+		return hc->handles + hc->num_handles++;
+
+	cached_handle* lru = NULL;
+	for(size_t i = 0; i < hc->num_handles; i++)
+		if(hc->handles[i].num_users == 0 && (lru == NULL || hc->handles[i].last_use < lru->last_use))
+			lru = hc->handles + i;
+
+	if(lru != NULL)
+		_CloseHandle(lru->hFile);
+
+	return lru;
+}
+
+
+/* Header Implementations */
+
+handle_cache* handle_cache_create(size_t capacity) {
+	handle_cache* hc = Calloc(1, sizeof(handle_cache));
+	hc->handles = Malloc(capacity * sizeof(cached_handle));
+	hc->capacity = capacity;
+
+	InitializeCriticalSection(&hc->lock);
+	return hc;
+}
+
+HANDLE handle_cache_open(handle_cache* hc, LPTSTR name) {
+	EnterCriticalSection(&hc->lock);
+
+	cached_handle* ch = find_handle(hc, name);
+	if(ch != NULL) {
+		ch->num_users++;
+		ch->last_use = hc->clock++;
+		LeaveCriticalSection(&hc->lock);
+		return ch->hFile;
+	}
+
+	LeaveCriticalSection(&hc->lock);
+
+	// Open the file without holding the lock, which may take long on network file systems
+	HANDLE hFile = _CreateFile(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	EnterCriticalSection(&hc->lock);
+
+	// The file isn't cached when every handle is in use, it's closed on release instead
+	ch = free_slot(hc);
+	if(ch != NULL) {
+		ch->name = name;
+		ch->hFile = hFile;
+		ch->num_users = 1;
+		ch->last_use = hc->clock++;
+	}
+
+	LeaveCriticalSection(&hc->lock);
+	return hFile;
+}
+
+void handle_cache_release(handle_cache* hc, HANDLE hFile) {
+	EnterCriticalSection(&hc->lock);
+
+	bool cached = false;
+	for(size_t i = 0; i < hc->num_handles && !cached; i++)
+		if(hc->handles[i].hFile == hFile) {
+			hc->handles[i].num_users--;
+			cached = true;
+		}
+
+	LeaveCriticalSection(&hc->lock);
+
+	if(!cached)
+		_CloseHandle(hFile);
+}
+
+void handle_cache_destroy(handle_cache* hc) {
+	for(size_t i = 0; i < hc->num_handles; i++)
+		_CloseHandle(hc->handles[i].hFile);
+
+	DeleteCriticalSection(&hc->lock);
+	Free(hc->handles);
+	Free(hc);
+}
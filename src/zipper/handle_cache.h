@@ -0,0 +1,65 @@
+#ifndef _HANDLE_CACHE_H
+#define _HANDLE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../platform.h"
+
+/*
+ * Small, bounded cache of files opened for reading, shared by threads.
+ *
+ * Files are opened when they're first needed and stay open while they're in use. Once released,
+ * they're kept open for reuse until the least recently used ones must make room, so the number
+ * of open files is bounded by the cache's capacity plus the number of users, instead of the
+ * number of files.
+ */
+
+typedef struct {
+	LPTSTR name;
+	HANDLE hFile;
+	unsigned num_users;
+	uint64_t last_use;
+} cached_handle;
+
+typedef struct {
+	cached_handle* handles;
+	size_t num_handles, capacity;
+	uint64_t clock; 			// incremented on every use
+
+	CRITICAL_SECTION lock;
+} handle_cache;
+
+/**
+ * Creates and returns a pointer to a new, empty handle cache.
+ *
+ * @param capacity the maximum number of files kept open
+ * @return a pointer to a new handle cache
+*/
+handle_cache* handle_cache_create(size_t capacity);
+
+/**
+ * Returns a read handle to the file at the specified path, opening it unless it's cached.
+ * It must be released once it's no longer used.
+ *
+ * @param hc the handle cache
+ * @param name the path to the file, which must stay valid while it's cached
+ * @return a handle to the file
+*/
+HANDLE handle_cache_open(handle_cache* hc, LPTSTR name);
+
+/**
+ * Releases the specified handle, returned by handle_cache_open, which may be closed from then on.
+ *
+ * @param hc the handle cache
+ * @param hFile the handle to release
+*/
+void handle_cache_release(handle_cache* hc, HANDLE hFile);
+
+/**
+ * Destroys the specified handle cache, whose handles must all be released, closing them.
+ *
+ * @param hc the handle cache to destroy
+*/
+void handle_cache_destroy(handle_cache* hc);
+
+#endif
@@ -0,0 +1,64 @@
+#include <string.h>
+#include "ring_queue.h"
+#include "../wrapper_functions.h"
+
+
+/* Header Implementations */
+
+ring_queue* ring_queue_create(size_t capacity, size_t element_size) {
+	ring_queue* q = Calloc(1, sizeof(ring_queue));
+	q->elements = Malloc(capacity * element_size);
+	q->element_size = element_size;
+	q->capacity = capacity;
+
+	InitializeCriticalSection(&q->lock);
+	InitializeConditionVariable(&q->not_full);
+	InitializeConditionVariable(&q->not_empty);
+	return q;
+}
+
+void ring_queue_push(ring_queue* q, const void* element) {
+	EnterCriticalSection(&q->lock);
+
+	while(q->size == q->capacity)
+		_SleepConditionVariableCS(&q->not_full, &q->lock, INFINITE);
+
+	size_t tail = (q->head + q->size++) % q->capacity;
+	memcpy(q->elements + tail * q->element_size, element, q->element_size);
+
+	WakeConditionVariable(&q->not_empty);
+	LeaveCriticalSection(&q->lock);
+}
+
+bool ring_queue_pop(ring_queue* q, void* out_element, bool wait) {
+	EnterCriticalSection(&q->lock);
+
+	while(q->size == 0 && !q->closed && wait)
+		_SleepConditionVariableCS(&q->not_empty, &q->lock, INFINITE);
+
+	if(q->size == 0) {
+		LeaveCriticalSection(&q->lock);
+		return false;
+	}
+
+	memcpy(out_element, q->elements + q->head * q->element_size, q->element_size);
+	q->head = (q->head + 1) % q->capacity;
+	q->size--;
+
+	WakeConditionVariable(&q->not_full);
+	LeaveCriticalSection(&q->lock);
+	return true;
+}
+
+void ring_queue_close(ring_queue* q) {
+	EnterCriticalSection(&q->lock);
+	q->closed = true;
+	WakeAllConditionVariable(&q->not_empty);
+	LeaveCriticalSection(&q->lock);
+}
+
+void ring_queue_destroy(ring_queue* q) {
+	DeleteCriticalSection(&q->lock);
+	Free(q->elements);
+	Free(q);
+}
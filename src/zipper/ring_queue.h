@@ -0,0 +1,70 @@
+#ifndef _RING_QUEUE_H
+#define _RING_QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "../platform.h"
+
+/*
+ * Bounded multi-producer, multi-consumer FIFO queue that connects pipeline stages.
+ *
+ * Elements are copied into a fixed ring allocated up front. Producers block while the queue is
+ * full, which holds a stage back when the next one can't keep up, and consumers block while it's
+ * empty until it's closed.
+ */
+
+typedef struct {
+	unsigned char* elements;
+	size_t element_size;
+	size_t capacity;
+	size_t head, size;
+	bool closed;
+
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE not_full;
+	CONDITION_VARIABLE not_empty;
+} ring_queue;
+
+/**
+ * Creates and returns a pointer to a new, empty ring queue.
+ *
+ * @param capacity the maximum number of elements in the queue
+ * @param element_size the size of each element
+ * @return a pointer to a new ring queue
+*/
+ring_queue* ring_queue_create(size_t capacity, size_t element_size);
+
+/**
+ * Copies the specified element to the end of the specified queue, waiting while it's full.
+ *
+ * @param q the queue to add the element to
+ * @param element the element to add to the queue
+*/
+void ring_queue_push(ring_queue* q, const void* element);
+
+/**
+ * Removes the element at the front of the specified queue and copies it. If the queue is empty, waits
+ * for an element if specified, until the queue is closed.
+ *
+ * @param q the queue to remove the element from
+ * @param out_element where to copy the removed element to
+ * @param wait whether to wait while the queue is empty
+ * @return true if an element was removed, false if the queue is empty and either closed or not waited on
+*/
+bool ring_queue_pop(ring_queue* q, void* out_element, bool wait);
+
+/**
+ * Closes the specified queue, which takes no more elements, waking up the waiting consumers.
+ *
+ * @param q the queue to close
+*/
+void ring_queue_close(ring_queue* q);
+
+/**
+ * Destroys the specified queue, freeing its allocated memory.
+ *
+ * @param q the queue to destroy
+*/
+void ring_queue_destroy(ring_queue* q);
+
+#endif
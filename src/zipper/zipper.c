@@ -2,155 +2,439 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <windows.h>
+#include "../platform.h"
 #include "../zip.h"
-#include "zipper_file.h"
-#include "queue.h"
+#include "../zip_index.h"
+#include "entry_table.h"
+#include "entry_scanner.h"
 #include "../compression/compression.h"
+#include "../compression/concurrency.h"
+#include "../compression/thread_pool.h"
 #include "../wrapper_functions.h"
 #include "../utils.h"
 
+#define MAX_BUFFERED_SIZE 				10 * 1024 * 1024	// larger files are split across cores by the codecs instead
+#define MAX_IN_FLIGHT_SIZE 				256 * 1024 * 1024
+#define IN_FLIGHT_ENTRIES_PER_THREAD 	16
+#define CACHED_HANDLES_PER_THREAD 		2
+#define DEFAULT_CACHE_SIZE_MB 			1024
+
+#define WRITE_BUFFER_SIZE 				4 * 1024 * 1024
+#define WRITE_ALIGNMENT 				4096
+
 typedef struct {
-    LPWSTR zip_name;
+    LPTSTR zip_name;
 	HANDLE hZip;
+	uint64_t zip_size;
 
 	uint64_t num_records;
+	bool streaming;
+
+	// Pending writes of contiguous data, flushed in large aligned chunks
+	unsigned char* write_buffer;
+	DWORD write_buffer_length;
+	uint64_t write_buffer_offset;
+
+	entry_table* et;
+	handle_cache* hc; 		// through which the files compressed ahead are opened
+	compression_cache* cc; 	// NULL unless compressed data is cached
 
-	queue* file_queue;
+	// The central directory of the zip being appended to, whose headers are kept as they are
+	unsigned char* old_central_directory;
+	uint64_t old_central_directory_size;
+	zip_index* old_zi;
+
+	// The zip being updated, whose unchanged entries' compressed data is copied as it is
+	HANDLE hPreviousZip;
+	zip_index* previous_zi;
 } zipper_context;
 
+typedef struct {
+	handle_cache* hc;
+	compression_cache* cc;
+	pending_entry pe;
+	unsigned char* compressed_data; 	// if it's compressed ahead
+	wait_group wg;
+
+	const zip_entry* previous_entry; 	// if it's copied from the previous zip
+	uint64_t previous_data_offset;
+} in_flight_entry;
+
 
 /* Zip Structs Functions */
 
-static void create_local_file_header(const zipper_file* zf, local_file_header* out_lfh) {
+static uint16_t zip_version(const entry_table* et, size_t entry) {
+	return et->compression_methods[entry] == ZSTANDARD ? ZIP_VERSION_ZSTANDARD : ZIP_VERSION;
+}
+
+static uint16_t zip64_extra_field_length(const entry_table* et, size_t entry) {
+	unsigned num_extra_fields = 2 * (et->uncompressed_sizes[entry] >= 0xFFFFFFFF) + (et->local_header_offsets[entry] >= 0xFFFFFFFF);
+	return num_extra_fields == 0 ? 0 : ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE + sizeof(uint64_t) * num_extra_fields;
+}
+
+static void create_local_file_header(const entry_table* et, size_t entry, local_file_header* out_lfh) {
+	uint64_t uncompressed_size = et->uncompressed_sizes[entry];
+
 	out_lfh->signature = LOCAL_FILE_HEADER_SIGNATURE;
-	out_lfh->version = ZIP_VERSION;
-	out_lfh->flags = 0x0000;
-	out_lfh->compression = zf->compression_method;
-	out_lfh->mod_time = zf->mod_time;
-	out_lfh->mod_date = zf->mod_date;
-	out_lfh->crc32 = zf->crc32;
-	out_lfh->compressed_size = zf->uncompressed_size >= 0xFFFFFFFF ? 0xFFFFFFFF : zf->compressed_size;
-	out_lfh->uncompressed_size = MIN(zf->uncompressed_size, 0xFFFFFFFF);
-	out_lfh->file_name_length = zf->utf8_name_length;
-	out_lfh->extra_field_length = zf->zip64_extra_field_length;
-}
-
-static void create_central_directory_header(const zipper_file* zf, central_directory_header* out_cdh) {
+	out_lfh->version = zip_version(et, entry);
+	out_lfh->flags = UTF8_ENCODING | (et->has_data_descriptors[entry] ? HAS_DATA_DESCRIPTOR : 0);
+	out_lfh->compression = et->compression_methods[entry];
+	out_lfh->mod_time = et->mod_times[entry];
+	out_lfh->mod_date = et->mod_dates[entry];
+
+	// The CRC32 and sizes follow the data in its data descriptor if it has one, except for the zip64 markers
+	if(et->has_data_descriptors[entry]) {
+		out_lfh->crc32 = 0;
+		out_lfh->compressed_size = uncompressed_size >= 0xFFFFFFFF ? 0xFFFFFFFF : 0;
+		out_lfh->uncompressed_size = uncompressed_size >= 0xFFFFFFFF ? 0xFFFFFFFF : 0;
+	}
+	else {
+		out_lfh->crc32 = et->crc32s[entry];
+		out_lfh->compressed_size = uncompressed_size >= 0xFFFFFFFF ? 0xFFFFFFFF : et->compressed_sizes[entry];
+		out_lfh->uncompressed_size = MIN(uncompressed_size, 0xFFFFFFFF);
+	}
+	out_lfh->file_name_length = et->utf8_name_lengths[entry];
+	out_lfh->extra_field_length = zip64_extra_field_length(et, entry);
+}
+
+static void create_central_directory_header(const entry_table* et, size_t entry, central_directory_header* out_cdh) {
+	uint64_t uncompressed_size = et->uncompressed_sizes[entry];
+
 	out_cdh->signature = CENTRAL_DIRECTORY_HEADER_SIGNATURE;
-	out_cdh->version_made_by = (WINDOWS_NTFS << 8) | ZIP_VERSION;
-	out_cdh->version_needed_to_extract = ZIP_VERSION;
-	out_cdh->flags = UTF8_ENCODING;
-	out_cdh->compression = zf->compression_method;
-	out_cdh->mod_time = zf->mod_time;
-	out_cdh->mod_date = zf->mod_date;
-	out_cdh->crc32 = zf->crc32;
-	out_cdh->compressed_size = zf->uncompressed_size >= 0xFFFFFFFF ? 0xFFFFFFFF : zf->compressed_size;
-	out_cdh->uncompressed_size = MIN(zf->uncompressed_size, 0xFFFFFFFF);
-	out_cdh->file_name_length = zf->utf8_name_length;
-	out_cdh->extra_field_length = zf->zip64_extra_field_length;
+	out_cdh->version_made_by = (WINDOWS_NTFS << 8) | zip_version(et, entry);
+	out_cdh->version_needed_to_extract = zip_version(et, entry);
+	out_cdh->flags = UTF8_ENCODING | (et->has_data_descriptors[entry] ? HAS_DATA_DESCRIPTOR : 0);
+	out_cdh->compression = et->compression_methods[entry];
+	out_cdh->mod_time = et->mod_times[entry];
+	out_cdh->mod_date = et->mod_dates[entry];
+	out_cdh->crc32 = et->crc32s[entry];
+	out_cdh->compressed_size = uncompressed_size >= 0xFFFFFFFF ? 0xFFFFFFFF : et->compressed_sizes[entry];
+	out_cdh->uncompressed_size = MIN(uncompressed_size, 0xFFFFFFFF);
+	out_cdh->file_name_length = et->utf8_name_lengths[entry];
+	out_cdh->extra_field_length = zip64_extra_field_length(et, entry);
 	out_cdh->file_comment_length = 0;
 	out_cdh->disk_number_start = 0;
 	out_cdh->internal_file_attributes = 0;
-	out_cdh->external_file_attributes = zf->windows_file_attributes;
-	out_cdh->local_header_offset = MIN(zf->local_header_offset, 0xFFFFFFFF);
+	out_cdh->external_file_attributes = et->windows_file_attributes[entry];
+	out_cdh->local_header_offset = MIN(et->local_header_offsets[entry], 0xFFFFFFFF);
 }
 
-static void create_end_of_central_directory_record(end_of_central_directory_record* out_eoccr,
-			uint64_t num_records, uint64_t central_directory_size, uint64_t central_directory_start_offset) {
-	out_eoccr->signature = END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE;
-	out_eoccr->disk_number = 0;
-	out_eoccr->central_directory_start_disk_number = 0;
-	out_eoccr->num_records_on_disk = MIN(num_records, 0xFFFF);
-	out_eoccr->total_num_records = MIN(num_records, 0xFFFF);
-	out_eoccr->central_directory_size = MIN(central_directory_size, 0xFFFFFFFF);
-	out_eoccr->central_directory_start_offset = MIN(central_directory_start_offset, 0xFFFFFFFF);
-	out_eoccr->comment_length = 0;
-}
-
-static void create_zip64_extra_field(const zipper_file* zf, zip64_extra_field* out_z64ef) {
+static void create_zip64_extra_field(const entry_table* et, size_t entry, zip64_extra_field* out_z64ef) {
 	unsigned char num_extra_fields = 0;
 
 	out_z64ef->header_id = ZIP64_EXTRA_FIELD_HEADER_ID;
 
-	if(zf->uncompressed_size >= 0xFFFFFFFF) {
-		out_z64ef->extra_fields[num_extra_fields++] = zf->uncompressed_size;
-		out_z64ef->extra_fields[num_extra_fields++] = zf->compressed_size;
+	if(et->uncompressed_sizes[entry] >= 0xFFFFFFFF) {
+		out_z64ef->extra_fields[num_extra_fields++] = et->uncompressed_sizes[entry];
+		out_z64ef->extra_fields[num_extra_fields++] = et->compressed_sizes[entry];
 	}
 
-	if(zf->local_header_offset >= 0xFFFFFFFF)
-		out_z64ef->extra_fields[num_extra_fields++] = zf->local_header_offset;
+	if(et->local_header_offsets[entry] >= 0xFFFFFFFF)
+		out_z64ef->extra_fields[num_extra_fields++] = et->local_header_offsets[entry];
 
 	out_z64ef->data_size = sizeof(uint64_t) * num_extra_fields;
 }
 
-static void create_zip64_end_of_central_directory_record(zip64_end_of_central_directory_record* out_z64eoccr,
-			uint64_t num_records, uint64_t central_directory_size, uint64_t central_directory_start_offset) {
-	out_z64eoccr->signature = ZIP64_END_OF_CENTRAL_DIRECTORY_RECORD_SIGNATURE;
-	out_z64eoccr->size_of_remaining_zip64_end_of_central_directory_record = ZIP64_END_OF_CENTRAL_DIRECTORY_RECORD_REMAINING_FIXED_FIELDS_SIZE;
-	out_z64eoccr->version_made_by = (WINDOWS_NTFS << 8) | ZIP_VERSION;
-	out_z64eoccr->version_needed_to_extract = ZIP_VERSION;
-	out_z64eoccr->disk_number = 0;
-	out_z64eoccr->central_directory_start_disk_number = 0;
-	out_z64eoccr->num_records_on_disk = num_records;
-	out_z64eoccr->total_num_records = num_records;
-	out_z64eoccr->central_directory_size = central_directory_size;
-	out_z64eoccr->central_directory_start_offset = central_directory_start_offset;
+static void create_data_descriptor(const entry_table* et, size_t entry, data_descriptor* out_dd) {
+	out_dd->signature = DATA_DESCRIPTOR_SIGNATURE;
+	out_dd->crc32 = et->crc32s[entry];
+	out_dd->compressed_size = et->compressed_sizes[entry];
+	out_dd->uncompressed_size = et->uncompressed_sizes[entry];
 }
 
-static void create_zip64_end_of_central_directory_locator(zip64_end_of_central_directory_locator* out_z64eoccl,
-			uint64_t zip64_end_of_central_directory_start_offset) {
-	out_z64eoccl->signature = ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE;
-	out_z64eoccl->zip64_end_of_central_directory_record_disk_number = 0;
-	out_z64eoccl->zip64_end_of_central_directory_record_offset = zip64_end_of_central_directory_start_offset;
-	out_z64eoccl->total_num_disks = 1;
+static void create_zip64_data_descriptor(const entry_table* et, size_t entry, zip64_data_descriptor* out_z64dd) {
+	out_z64dd->signature = DATA_DESCRIPTOR_SIGNATURE;
+	out_z64dd->crc32 = et->crc32s[entry];
+	out_z64dd->compressed_size = et->compressed_sizes[entry];
+	out_z64dd->uncompressed_size = et->uncompressed_sizes[entry];
 }
 
 
 /* Main Functions */
 
-static void write_file_to_zip(zipper_context* zc, zipper_file* zf) {
-	printf("Writing %ls to zip\n", zf->utf16_name);
+/**
+ * Writes the specified number of bytes from the start of the write buffer to the zip and moves the rest to the front.
+*/
+static void flush_write_buffer_prefix(zipper_context* zc, DWORD size) {
+	_WriteFileAt(zc->hZip, zc->write_buffer, size, zc->write_buffer_offset);
 
-	queue_enqueue(zc->file_queue, zf);
+	zc->write_buffer_length -= size;
+	zc->write_buffer_offset += size;
+	memmove(zc->write_buffer, zc->write_buffer + size, zc->write_buffer_length);
+}
 
-	zf->local_header_offset = _GetFilePointerEx(zc->hZip);
+/**
+ * Writes all pending data to the zip. Must be called before anything else writes to the zip's handle.
+ * 
+ * @param zc the zipper context
+*/
+static void flush_write_buffer(zipper_context* zc) {
+	if(zc->write_buffer_length > 0)
+		flush_write_buffer_prefix(zc, zc->write_buffer_length);
+}
 
-	// Calculate the zip64 extra field's length if applicable
-	if(zf->uncompressed_size >= 0xFFFFFFFF || zf->local_header_offset >= 0xFFFFFFFF)
-		zf->zip64_extra_field_length = ZIP64_EXTRA_FIELD_FIXED_FIELDS_SIZE + sizeof(uint64_t) * (2 * (zf->uncompressed_size >= 0xFFFFFFFF) + (zf->local_header_offset >= 0xFFFFFFFF));
+/**
+ * Writes data to the zip at the specified offset, without moving the zip's file pointer,
+ * and returns the offset right after the written data. The offset is ignored when the zip
+ * is a pipe, whose writes are appended in order.
+ * 
+ * Data is gathered in the write buffer as long as it continues the data already there, so the many
+ * small headers are written together in a few large writes that end at aligned offsets.
+ * 
+ * @param zc the zipper context
+ * @param data the data to write
+ * @param size the number of bytes to write
+ * @param offset the offset in the zip to write the data to
+ * @return the offset right after the written data
+*/
+static uint64_t write_to_zip(zipper_context* zc, LPCVOID data, DWORD size, uint64_t offset) {
+	if(zc->write_buffer_length > 0 && offset != zc->write_buffer_offset + zc->write_buffer_length)
+		flush_write_buffer(zc);
+	if(zc->write_buffer_length == 0)
+		zc->write_buffer_offset = offset;
+
+	// Write out the buffer up to its last aligned offset once the data doesn't fit, keeping the rest
+	if(size > WRITE_BUFFER_SIZE - zc->write_buffer_length) {
+		uint64_t aligned_end = (zc->write_buffer_offset + zc->write_buffer_length) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+		if(aligned_end > zc->write_buffer_offset)
+			flush_write_buffer_prefix(zc, aligned_end - zc->write_buffer_offset);
+	}
 
-	// Write the file's compressed data if it's not empty
-	if(zf->uncompressed_size > 0) {
-		uint64_t header_size = sizeof(local_file_header) + zf->utf8_name_length + zf->zip64_extra_field_length;
-		zfile_compress_and_write(zf, zc->zip_name, zf->local_header_offset + header_size);
+	// Data that still doesn't fit is written directly
+	if(size > WRITE_BUFFER_SIZE - zc->write_buffer_length) {
+		flush_write_buffer(zc);
+		_WriteFileAt(zc->hZip, data, size, offset);
+		return offset + size;
 	}
 
-	// Write the header
+	memcpy(zc->write_buffer + zc->write_buffer_length, data, size);
+	zc->write_buffer_length += size;
+	return offset + size;
+}
+
+static uint64_t write_local_file_header_to_zip(zipper_context* zc, size_t entry) {
+	const entry_table* et = zc->et;
+
 	local_file_header lfh;
-	create_local_file_header(zf, &lfh);
-	_WriteFile(zc->hZip, &lfh, sizeof(local_file_header), NULL, NULL);
-	_WriteFile(zc->hZip, zf->utf8_name, zf->utf8_name_length, NULL, NULL);
+	create_local_file_header(et, entry, &lfh);
+	uint64_t offset = write_to_zip(zc, &lfh, sizeof(local_file_header), et->local_header_offsets[entry]);
+	offset = write_to_zip(zc, et->utf8_names[entry], et->utf8_name_lengths[entry], offset);
 
-	// Write the zip64 extra field if necessary
-	if(zf->zip64_extra_field_length > 0) {
+	// Write the zip64 extra field if necessary, its sizes are in the data descriptor too if there is one
+	if(lfh.extra_field_length > 0) {
 		zip64_extra_field z64ef;
-		create_zip64_extra_field(zf, &z64ef);
-		_WriteFile(zc->hZip, &z64ef, zf->zip64_extra_field_length, NULL, NULL);
+		create_zip64_extra_field(et, entry, &z64ef);
+		if(et->has_data_descriptors[entry] && et->uncompressed_sizes[entry] >= 0xFFFFFFFF)
+			z64ef.extra_fields[0] = z64ef.extra_fields[1] = 0;
+		offset = write_to_zip(zc, &z64ef, lfh.extra_field_length, offset);
 	}
 
-	if(zf->uncompressed_size > 0) 
-		// Advance the file pointer back to the end of the file's data
-		_SetFilePointerEx(zc->hZip, (LARGE_INTEGER){.QuadPart = zf->compressed_size}, NULL, FILE_CURRENT);
-	
-	// Write any children if any
-	if(zf->num_children > 0)
-		for(unsigned i = 0; i < zf->num_children; i++)
-			write_file_to_zip(zc, zf->children[i]);
+	return offset;
+}
+
+/**
+ * Adds the specified entry to the table and writes it to the zip, along with its compressed data if it
+ * was compressed ahead, which is then freed.
+*/
+static void write_file_to_zip(zipper_context* zc, const pending_entry* pe, unsigned char* compressed_data) {
+	entry_table* et = zc->et;
+
+	fprintf(zipper_log, "Writing " TSTR_FMT " to zip\n", pe->name);
+
+	size_t entry = entry_table_append(et, pe);
+	et->local_header_offsets[entry] = zc->zip_size;
+
+	uint64_t header_size = sizeof(local_file_header) + et->utf8_name_lengths[entry] + zip64_extra_field_length(et, entry);
+	uint64_t data_offset = et->local_header_offsets[entry] + header_size;
+
+	// Files that weren't compressed ahead are compressed straight into the zip. When streaming, their CRC32 and
+	// sizes aren't known when the header must be written, so they follow the data in a data descriptor instead
+	bool compressed_in_place = compressed_data == NULL && et->uncompressed_sizes[entry] > 0;
+	et->has_data_descriptors[entry] = zc->streaming && compressed_in_place;
+
+	// The header names the compression method, so it's settled before the header is written ahead of the data
+	if(et->has_data_descriptors[entry])
+		entry_select_compression(et, entry, pe->name);
+
+	if(compressed_in_place && !et->has_data_descriptors[entry]) {
+		flush_write_buffer(zc);
+		entry_compress_and_write(et, entry, pe->name, zc->hZip, data_offset, zc->cc);
+	}
+
+	write_local_file_header_to_zip(zc, entry);
+
+	// Write the file's compressed data if it was compressed ahead
+	if(compressed_data != NULL) {
+		write_to_zip(zc, compressed_data, et->compressed_sizes[entry], data_offset);
+		Free(compressed_data);
+	}
+
+	zc->zip_size = data_offset + et->compressed_sizes[entry];
+
+	if(et->has_data_descriptors[entry]) {
+		flush_write_buffer(zc);
+		entry_compress_and_write(et, entry, pe->name, zc->hZip, data_offset, zc->cc);
+		zc->zip_size = data_offset + et->compressed_sizes[entry];
+
+		if(zip64_extra_field_length(et, entry) > 0) {
+			zip64_data_descriptor z64dd;
+			create_zip64_data_descriptor(et, entry, &z64dd);
+			zc->zip_size = write_to_zip(zc, &z64dd, sizeof(zip64_data_descriptor), zc->zip_size);
+		}
+		else {
+			data_descriptor dd;
+			create_data_descriptor(et, entry, &dd);
+			zc->zip_size = write_to_zip(zc, &dd, sizeof(data_descriptor), zc->zip_size);
+		}
+	}
 
 	zc->num_records++;
 }
 
+/**
+ * Adds the specified entry to the table and writes it to the zip with the compressed data and CRC32 of the
+ * specified unchanged entry of the previous zip, copied as they are.
+*/
+static void copy_file_to_zip(zipper_context* zc, const pending_entry* pe, const zip_entry* ze, uint64_t previous_data_offset) {
+	entry_table* et = zc->et;
+
+	fprintf(zipper_log, "Copying " TSTR_FMT " from previous zip\n", pe->name);
+
+	pending_entry copied_pe = *pe;
+	copied_pe.compression_method = ze->compression;
+	copied_pe.compressed_size = ze->compressed_size;
+	copied_pe.crc32 = ze->crc32;
+
+	size_t entry = entry_table_append(et, &copied_pe);
+	et->local_header_offsets[entry] = zc->zip_size;
+	et->has_data_descriptors[entry] = false;
+
+	uint64_t data_offset = write_local_file_header_to_zip(zc, entry);
+	flush_write_buffer(zc);
+
+	// Let the kernel copy the data if it can, it's only copied by hand otherwise
+	bool copied = false;
+#ifdef COPY_FILE_RANGE_SUPPORTED
+	copied = _CopyFileRange(zc->hPreviousZip, previous_data_offset, zc->hZip, data_offset, ze->compressed_size);
+#endif
+
+	for(uint64_t copied_size = 0; !copied && copied_size < ze->compressed_size; ) {
+		DWORD size = MIN(ze->compressed_size - copied_size, WRITE_BUFFER_SIZE);
+		if(_ReadFileAt(zc->hPreviousZip, zc->write_buffer, size, previous_data_offset + copied_size) != size)
+			exit_with_error("Previous zip file is corrupt\n");
+
+		_WriteFileAt(zc->hZip, zc->write_buffer, size, data_offset + copied_size);
+		copied_size += size;
+	}
+
+	zc->zip_size = data_offset + ze->compressed_size;
+	zc->num_records++;
+}
+
+/**
+ * Looks the specified entry up in the previous zip and, if it's unchanged there, with the same size and
+ * last modification time, and compressed with the compression method asked for now, sets it to be copied
+ * from it. Entries that are stored with other methods or with flags that the zipper doesn't write itself
+ * are compressed again, as are entries stored instead of compressed, to let the compressing stage decide
+ * again. Zips don't record the compression level, so entries compressed at another level are copied.
+*/
+static void find_previous_entry(zipper_context* zc, in_flight_entry* ife) {
+	ife->previous_entry = NULL;
+	if(zc->previous_zi == NULL || ife->pe.uncompressed_size == 0)
+		return;
+
+	const zip_entry* ze = zip_index_lookup(zc->previous_zi, ife->pe.utf8_name);
+	if(ze == NULL || ze->uncompressed_size != ife->pe.uncompressed_size || ze->mod_time != ife->pe.mod_time || ze->mod_date != ife->pe.mod_date)
+		return;
+	if(ze->flags & ~(UTF8_ENCODING | HAS_DATA_DESCRIPTOR | DEFLATE_OPTIONS))
+		return;
+	if(ze->compression != (ife->pe.compression_method & ~AUTO_COMPRESSION))
+		return;
+
+	// The data follows the local header, whose extra field may differ from the central directory's
+	local_file_header lfh;
+	if(_ReadFileAt(zc->hPreviousZip, &lfh, sizeof(local_file_header), ze->local_header_offset) != sizeof(local_file_header)
+			|| lfh.signature != LOCAL_FILE_HEADER_SIGNATURE)
+		return;
+
+	ife->previous_entry = ze;
+	ife->previous_data_offset = ze->local_header_offset + sizeof(local_file_header) + lfh.file_name_length + lfh.extra_field_length;
+}
+
+static bool is_compressed_ahead(const in_flight_entry* ife) {
+	return ife->previous_entry == NULL && ife->pe.uncompressed_size > 0 && ife->pe.uncompressed_size <= MAX_BUFFERED_SIZE;
+}
+
+static void compress_to_buffer_task(void* data) {
+	in_flight_entry* ife = (in_flight_entry*) data;
+	ife->compressed_data = pending_entry_compress_to_buffer(&ife->pe, ife->hc, ife->cc);
+}
+
+/**
+ * Writes the scanner's entries to the zip in order, as they're found. Small files are compressed into memory
+ * on the thread pool ahead of the writer, within a memory budget, and larger files are compressed in place
+ * when their turn comes. The output is the same as writing the entries one by one.
+ * 
+ * The entries taken from the scanner are kept in a ring, in order, until they're written. Its size bounds
+ * how far the writer looks ahead, which holds the scanner back through its queue when the writer falls behind.
+*/
+static void write_files_to_zip(zipper_context* zc, entry_scanner* es) {
+	unsigned max_in_flight_entries = num_cores() * IN_FLIGHT_ENTRIES_PER_THREAD;
+	in_flight_entry* in_flight_entries = Calloc(max_in_flight_entries, sizeof(in_flight_entry));
+	uint64_t first_in_flight_entry = 0, next_scheduled_entry = 0;
+	unsigned num_in_flight_entries = 0;
+	uint64_t in_flight_size = 0;
+
+	for(;;) {
+		// Take the entries found so far, only waiting for the scanner when there's nothing to write
+		while(num_in_flight_entries < max_in_flight_entries) {
+			in_flight_entry* ife = in_flight_entries + (first_in_flight_entry + num_in_flight_entries) % max_in_flight_entries;
+			if(!entry_scanner_next(es, &ife->pe, num_in_flight_entries == 0))
+				break;
+			if(zc->old_zi != NULL && zip_index_lookup(zc->old_zi, ife->pe.utf8_name) != NULL) {
+				fprintf(zipper_log, "Skipping " TSTR_FMT ", already in zip\n", ife->pe.name);
+				continue;
+			}
+			ife->hc = zc->hc;
+			ife->cc = zc->cc;
+			ife->compressed_data = NULL;
+			find_previous_entry(zc, ife);
+			num_in_flight_entries++;
+		}
+
+		if(num_in_flight_entries == 0)
+			break;
+
+		// Schedule the following entries, always letting at least one be compressed
+		for(; next_scheduled_entry < first_in_flight_entry + num_in_flight_entries; next_scheduled_entry++) {
+			in_flight_entry* ife = in_flight_entries + next_scheduled_entry % max_in_flight_entries;
+			if(!is_compressed_ahead(ife))
+				continue;
+			if(in_flight_size > 0 && in_flight_size + ife->pe.uncompressed_size > MAX_IN_FLIGHT_SIZE)
+				break;
+
+			in_flight_size += ife->pe.uncompressed_size;
+			thread_pool_submit(&ife->wg, compress_to_buffer_task, ife);
+		}
+
+		in_flight_entry* ife = in_flight_entries + first_in_flight_entry % max_in_flight_entries;
+		if(is_compressed_ahead(ife)) {
+			wait_group_wait(&ife->wg);
+			in_flight_size -= ife->pe.uncompressed_size;
+		}
+
+		if(ife->previous_entry != NULL)
+			copy_file_to_zip(zc, &ife->pe, ife->previous_entry, ife->previous_data_offset);
+		else
+			write_file_to_zip(zc, &ife->pe, ife->compressed_data);
+
+		first_in_flight_entry++;
+		num_in_flight_entries--;
+	}
+
+	Free(in_flight_entries);
+}
+
 static void write_end_of_central_directory_to_zip(zipper_context* zc, uint64_t central_directory_size, uint64_t central_directory_start_offset) {
 	// Write a zip64 end of central directory record (and locator) if necessary
 	if(zc->num_records > 0xFFFF || central_directory_size > 0xFFFFFFFF || central_directory_start_offset > 0xFFFFFFFF) {
@@ -160,70 +444,265 @@ static void write_end_of_central_directory_to_zip(zipper_context* zc, uint64_t c
 		zip64_end_of_central_directory_locator z64eoccl;
 		create_zip64_end_of_central_directory_locator(&z64eoccl, zip64_end_of_central_directory_start_offset);
 
-		_WriteFile(zc->hZip, &z64eoccr, sizeof(zip64_end_of_central_directory_record), NULL, NULL);
-		_WriteFile(zc->hZip, &z64eoccl, sizeof(zip64_end_of_central_directory_locator), NULL, NULL);
+		zc->zip_size = write_to_zip(zc, &z64eoccr, sizeof(zip64_end_of_central_directory_record), zc->zip_size);
+		zc->zip_size = write_to_zip(zc, &z64eoccl, sizeof(zip64_end_of_central_directory_locator), zc->zip_size);
 	}
 
 	end_of_central_directory_record eoccr;
 	create_end_of_central_directory_record(&eoccr, zc->num_records, central_directory_size, central_directory_start_offset);
-	_WriteFile(zc->hZip, &eoccr, sizeof(end_of_central_directory_record), NULL, NULL);
+	zc->zip_size = write_to_zip(zc, &eoccr, sizeof(end_of_central_directory_record), zc->zip_size);
 }
 
 static void write_central_directory_to_zip(zipper_context* zc) {
-	uint64_t central_directory_start_offset = _GetFilePointerEx(zc->hZip);
-
-	while(zc->file_queue->size > 0) {
-		zipper_file* zf = queue_dequeue(zc->file_queue);
+	const entry_table* et = zc->et;
+	uint64_t central_directory_start_offset = zc->zip_size;
+
+	// Copy the appended to zip's headers first, their entries' data didn't move
+	for(uint64_t copied_size = 0; copied_size < zc->old_central_directory_size; ) {
+		DWORD size = MIN(zc->old_central_directory_size - copied_size, WRITE_BUFFER_SIZE);
+		zc->zip_size = write_to_zip(zc, zc->old_central_directory + copied_size, size, zc->zip_size);
+		copied_size += size;
+	}
 
+	for(size_t i = 0; i < et->num_entries; i++) {
 		// Get the central directory header and write it to the zip
 		central_directory_header cdh;
-		create_central_directory_header(zf, &cdh);
-		_WriteFile(zc->hZip, &cdh, sizeof(central_directory_header), NULL, NULL);
-		_WriteFile(zc->hZip, zf->utf8_name, zf->utf8_name_length, NULL, NULL);
+		create_central_directory_header(et, i, &cdh);
+		zc->zip_size = write_to_zip(zc, &cdh, sizeof(central_directory_header), zc->zip_size);
+		zc->zip_size = write_to_zip(zc, et->utf8_names[i], et->utf8_name_lengths[i], zc->zip_size);
 		
 		// Write the zip64 extra field if necessary
-		if(zf->zip64_extra_field_length > 0) {
+		if(cdh.extra_field_length > 0) {
 			zip64_extra_field z64ef;
-			create_zip64_extra_field(zf, &z64ef);
-			_WriteFile(zc->hZip, &z64ef, zf->zip64_extra_field_length, NULL, NULL);
+			create_zip64_extra_field(et, i, &z64ef);
+			zc->zip_size = write_to_zip(zc, &z64ef, cdh.extra_field_length, zc->zip_size);
 		}
-		
-		zfile_destroy(zf);
 	}
 
-	uint64_t central_directory_size = _GetFilePointerEx(zc->hZip) - central_directory_start_offset;
+	uint64_t central_directory_size = zc->zip_size - central_directory_start_offset;
 
 	write_end_of_central_directory_to_zip(zc, central_directory_size, central_directory_start_offset);
 }
 
-int main() {
-	int argc;
-	LPWSTR* argv = _CommandLineToArgvW(GetCommandLineW(), &argc);
+/**
+ * Opens the existing zip to append to and reads its central directory. The new entries are written over
+ * it, from its start offset, so the existing entries' data is never rewritten.
+ * 
+ * @param zc the zipper context
+*/
+static void open_zip_to_append(zipper_context* zc) {
+	zc->hZip = _CreateFile(zc->zip_name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	central_directory_location cdl;
+	if(!find_central_directory(zc->hZip, &cdl))
+		exit_with_error("End of central directory record not found\n");
+
+	zc->old_central_directory = load_central_directory(zc->hZip, cdl.central_directory_start_offset, cdl.central_directory_size);
+	if(zc->old_central_directory != NULL)
+		zc->old_zi = zip_index_parse(zc->old_central_directory, cdl.central_directory_size, cdl.num_records);
+	if(zc->old_zi == NULL)
+		exit_with_error("Zip file is corrupt\n");
+
+	zc->old_central_directory_size = cdl.central_directory_size;
+	zc->zip_size = cdl.central_directory_start_offset;
+	zc->num_records = cdl.num_records;
+}
+
+/**
+ * Opens the previous version of the zip being written and indexes its entries, to copy the unchanged ones from.
+ * 
+ * @param zc the zipper context
+ * @param previous_zip_name the previous zip's name
+*/
+static void open_previous_zip(zipper_context* zc, LPTSTR previous_zip_name) {
+	zc->hPreviousZip = _CreateFile(previous_zip_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	central_directory_location cdl;
+	if(!find_central_directory(zc->hPreviousZip, &cdl))
+		exit_with_error("Previous zip's end of central directory record not found\n");
+
+	zc->previous_zi = zip_index_load(zc->hPreviousZip, cdl.central_directory_start_offset, cdl.central_directory_size, cdl.num_records);
+	if(zc->previous_zi == NULL)
+		exit_with_error("Previous zip file is corrupt\n");
+}
+
+int _tmain(int argc, TCHAR* argv[]) {
+	unsigned compression_method = DEFLATE;
+	bool auto_compression = false;
+	bool streaming = false;
+	bool appending = false;
+	LPTSTR previous_zip_name = NULL;
+	LPTSTR cache_path = NULL;
+	long cache_size_mb = DEFAULT_CACHE_SIZE_MB;
+	int level = DEFLATE_DEFAULT_LEVEL;
+	int arg = 1;
+
+	zipper_log = stdout;
+
+	// Parse options: -0 stores files, -1 to -9 set the Deflate compression level and -z[level] selects Zstandard.
+	// -a stores the files that look incompressible, -n sets the suffixes that are always stored (implies -a)
+	// -s writes the zip in a single pass, as when it's written to the standard output with "-", -g appends
+	// the files to an existing zip, skipping the ones it already has, and -u copies the files that are unchanged
+	// since the specified previous zip from it instead of compressing them again. -c caches compressed data in the
+	// specified directory, across runs, and -C bounds the cache's size in megabytes
+	for(; arg < argc && argv[arg][0] == TEXT('-') && argv[arg][1] != TEXT('\0'); arg++) {
+		TCHAR option = argv[arg][1];
+
+		if(option == TEXT('g') && argv[arg][2] == TEXT('\0')) {
+			appending = true;
+			continue;
+		}
+
+		if(option == TEXT('u') && argv[arg][2] == TEXT('\0')) {
+			if(++arg == argc) {
+				argc = 0;
+				break;
+			}
+			previous_zip_name = argv[arg];
+			continue;
+		}
+
+		if((option == TEXT('c') || option == TEXT('C')) && argv[arg][2] == TEXT('\0')) {
+			if(++arg == argc) {
+				argc = 0;
+				break;
+			}
+
+			if(option == TEXT('c'))
+				cache_path = argv[arg];
+			else {
+				LPTSTR size_end;
+				cache_size_mb = _tcstol(argv[arg], &size_end, 10);
+				if(*size_end != TEXT('\0') || cache_size_mb < 1) {
+					argc = 0;
+					break;
+				}
+			}
+			continue;
+		}
 
-	if(argc < 2) {
-		printf("Usage: zipper archive_name file_to_add_1 ... file_to_add_n\n");
+		if(option == TEXT('s') && argv[arg][2] == TEXT('\0')) {
+			streaming = true;
+			continue;
+		}
+
+		if((option == TEXT('a') || option == TEXT('n')) && argv[arg][2] == TEXT('\0')) {
+			if(option == TEXT('n')) {
+				if(++arg == argc) {
+					argc = 0;
+					break;
+				}
+				auto_compression_set_stored_suffixes(argv[arg]);
+			}
+
+			auto_compression = true;
+			continue;
+		}
+
+		if(option == TEXT('z')) {
+#ifdef ZSTANDARD_SUPPORTED
+			LPTSTR level_end;
+			level = argv[arg][2] == TEXT('\0') ? ZSTANDARD_DEFAULT_LEVEL : _tcstol(argv[arg] + 2, &level_end, 10);
+
+			if(argv[arg][2] != TEXT('\0') && (*level_end != TEXT('\0') || level < ZSTANDARD_MIN_LEVEL || level > ZSTANDARD_MAX_LEVEL)) {
+				argc = 0;
+				break;
+			}
+
+			compression_method = ZSTANDARD;
+			zstd_set_level(level);
+			continue;
+#else
+			exit_with_error("zipper was built without Zstandard support\n");
+#endif
+		}
+
+		if(option < TEXT('0') || option > TEXT('9') || argv[arg][2] != TEXT('\0')) {
+			argc = 0;
+			break;
+		}
+
+		if(option == TEXT('0'))
+			compression_method = NO_COMPRESSION;
+		else {
+			compression_method = DEFLATE;
+			level = option - TEXT('0');
+			deflate_set_level(level);
+		}
+	}
+
+	if(argc - arg < 1) {
+		printf("Usage: zipper [-0 | -1 ... -9 | -z[1 ... 22]] [-a] [-n suffix_1:...:suffix_n] [-s] [-g | -u previous_archive] [-c cache_directory [-C cache_megabytes]] archive_name | - file_to_add_1 ... file_to_add_n\n");
 		return 0;
 	}
 
+	if(auto_compression)
+		compression_method |= AUTO_COMPRESSION;
+
 	zipper_context zc = {0};
+	zc.write_buffer = Malloc(WRITE_BUFFER_SIZE);
+
+	zc.zip_name = argv[arg++];
+	zc.streaming = streaming;
 
-	zc.zip_name = argv[1];
-	zc.hZip = _CreateFileW(zc.zip_name, GENERIC_WRITE, FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(appending && (zc.streaming || _tcscmp(zc.zip_name, TEXT("-")) == 0))
+		exit_with_error("Can't append to a zip that's being streamed\n");
+	if(previous_zip_name != NULL && (appending || _tcscmp(previous_zip_name, zc.zip_name) == 0))
+		exit_with_error("The previous zip must be a different file from the one being written\n");
 
-	zc.file_queue = queue_create();
+	// Open the previous zip first, so a missing or corrupt one is reported before anything is written
+	if(previous_zip_name != NULL)
+		open_previous_zip(&zc, previous_zip_name);
 
-	for(int i = 2; i < argc; i++) {
-		zipper_file* zf = zfile_create(argv[i], NO_COMPRESSION);
-		write_file_to_zip(&zc, zf);
+	// Write the zip to the standard output if its name is "-", keeping the messages out of it
+	if(_tcscmp(zc.zip_name, TEXT("-")) == 0) {
+		zc.hZip = _GetStdHandle(STD_OUTPUT_HANDLE);
+		zc.streaming = true;
+		zipper_log = stderr;
 	}
+	else if(appending)
+		open_zip_to_append(&zc);
+	else
+		zc.hZip = _CreateFile(zc.zip_name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	zc.et = entry_table_create();
+	zc.hc = handle_cache_create(num_cores() * CACHED_HANDLES_PER_THREAD);
 
-	printf("Writing central directory to zip\n");
+	// The zip is open for reading too, the cache takes the data compressed straight into it from there
+	if(cache_path != NULL)
+		zc.cc = compression_cache_create(cache_path, (uint64_t) cache_size_mb * 1024 * 1024, level);
+
+	entry_scanner* es = entry_scanner_start(argv + arg, argc - arg, compression_method);
+	write_files_to_zip(&zc, es);
+
+	fprintf(zipper_log, "Writing central directory to zip\n");
 
 	write_central_directory_to_zip(&zc);
+	flush_write_buffer(&zc);
+
+	// Drop anything left past the end, the appended to zip's old tail or compressed data of files that were stored
+	// instead, which never happens when streaming
+	if(!zc.streaming) {
+		_SetFilePointerEx(zc.hZip, (LARGE_INTEGER){.QuadPart = zc.zip_size}, NULL, FILE_BEGIN);
+		_SetEndOfFile(zc.hZip);
+	}
 
-	printf("Done\n");
+	fprintf(zipper_log, "Done\n");
 
-	Free(zc.file_queue);
+	Free(zc.write_buffer);
+	handle_cache_destroy(zc.hc);
+	if(zc.cc != NULL)
+		compression_cache_destroy(zc.cc);
+	entry_table_destroy(zc.et);
+	if(zc.old_zi != NULL) {
+		zip_index_destroy(zc.old_zi);
+		Free(zc.old_central_directory);
+	}
+	if(zc.previous_zi != NULL) {
+		zip_index_destroy(zc.previous_zi);
+		_CloseHandle(zc.hPreviousZip);
+	}
+	entry_scanner_destroy(es);
 	_CloseHandle(zc.hZip);
 	return 0;
 }